@@ -1,6 +1,7 @@
 #include "AmpGateAlgorithm.h"
 #include "IPlugParameter.h"
 #include "ReacomaExtension.h"
+#include "TakeMarkers.h"
 
 AmpGateAlgorithm::AmpGateAlgorithm(ReacomaExtension *apiProvider)
     : FlucomaAlgorithm<NRTThreadedAmpGateClient>(apiProvider) {}
@@ -44,28 +45,17 @@ bool AmpGateAlgorithm::DoProcess(InputBufferT::type &sourceBuffer,
         std::make_shared<MemoryBufferAdaptor>(1, estimatedSlices, sampleRate);
     auto slicesOutputBuffer = fluid::client::BufferT::type(outBuffer);
 
-    auto rampUpTime =
-        mApiProvider->GetParam(mBaseParamIdx + kRampUpTime)->Value();
-    auto rampDownTime =
-        mApiProvider->GetParam(mBaseParamIdx + kRampDownTime)->Value();
-    auto onThreshold =
-        mApiProvider->GetParam(mBaseParamIdx + kOnThreshold)->Value();
-    auto offThreshold =
-        mApiProvider->GetParam(mBaseParamIdx + kOffThreshold)->Value();
-    auto minEventDuration =
-        mApiProvider->GetParam(mBaseParamIdx + kMinEventDuration)->Value();
-    auto minSilenceDuration =
-        mApiProvider->GetParam(mBaseParamIdx + kMinSilenceDuration)->Value();
-    auto minTimeAboveThreshold =
-        mApiProvider->GetParam(mBaseParamIdx + kMinTimeAboveThreshold)->Value();
-    auto minTimeBelowThreshold =
-        mApiProvider->GetParam(mBaseParamIdx + kMinTimeBelowThreshold)->Value();
-    auto upwardLookupTime =
-        mApiProvider->GetParam(mBaseParamIdx + kUpwardLookupTime)->Value();
-    auto downwardLookupTime =
-        mApiProvider->GetParam(mBaseParamIdx + kDownwardLookupTime)->Value();
-    auto hiPassFreq =
-        mApiProvider->GetParam(mBaseParamIdx + kHiPassFreq)->Value();
+    auto rampUpTime = GetParamValue(kRampUpTime);
+    auto rampDownTime = GetParamValue(kRampDownTime);
+    auto onThreshold = GetParamValue(kOnThreshold);
+    auto offThreshold = GetParamValue(kOffThreshold);
+    auto minEventDuration = GetParamValue(kMinEventDuration);
+    auto minSilenceDuration = GetParamValue(kMinSilenceDuration);
+    auto minTimeAboveThreshold = GetParamValue(kMinTimeAboveThreshold);
+    auto minTimeBelowThreshold = GetParamValue(kMinTimeBelowThreshold);
+    auto upwardLookupTime = GetParamValue(kUpwardLookupTime);
+    auto downwardLookupTime = GetParamValue(kDownwardLookupTime);
+    auto hiPassFreq = GetParamValue(kHiPassFreq);
 
     mParams.template set<0>(std::move(sourceBuffer), nullptr);
     mParams.template set<1>(std::move(LongT::type(0)), nullptr);
@@ -100,22 +90,8 @@ bool AmpGateAlgorithm::HandleResults(MediaItem *item, MediaItem_Take *take,
     if (!reader.exists() || !reader.valid())
         return false;
 
-    int markerCount = GetNumTakeMarkers(take);
-    for (int i = markerCount - 1; i >= 0; i--) {
-        DeleteTakeMarker(take, i);
-    }
-
     double itemLength = GetMediaItemInfo_Value(item, "D_LENGTH");
-    auto onsetView = reader.samps(0);
-    for (fluid::index i = 0; i < onsetView.size(); i++) {
-        if (onsetView(i) > 0) {
-            double markerTimeInSeconds =
-                static_cast<double>(onsetView(i)) / sampleRate;
-            if (markerTimeInSeconds < itemLength) {
-                SetTakeMarker(take, -1, "", &markerTimeInSeconds, nullptr);
-            }
-        }
-    }
+    std::vector<TakeMarker> markers;
 
     // Offset marker colour
     int r = 255;
@@ -124,19 +100,35 @@ bool AmpGateAlgorithm::HandleResults(MediaItem *item, MediaItem_Take *take,
 
     int color = ColorToNative(r, g, b) | 0x1000000;
 
-    auto offsetView = reader.samps(1);
-    for (fluid::index i = 0; i < offsetView.size(); i++) {
-        if (offsetView(i) > 0) {
-            double markerTimeInSeconds =
-                static_cast<double>(offsetView(i)) / sampleRate;
-            if (markerTimeInSeconds < itemLength) {
-                SetTakeMarker(take, -1, "", &markerTimeInSeconds, &color);
+    for (int channel = 0; channel < 2; channel++) {
+        auto view = reader.samps(channel);
+        for (fluid::index i = 0; i < view.size(); i++) {
+            if (view(i) > 0) {
+                double markerTimeInSeconds =
+                    static_cast<double>(view(i)) / sampleRate;
+                if (markerTimeInSeconds < itemLength)
+                    markers.push_back(
+                        {markerTimeInSeconds, channel == 1 ? color : 0});
             }
         }
     }
+
+    ApplyTakeMarkers(take, std::move(markers), 0.5 / sampleRate);
     return true;
 }
 
+bool AmpGateAlgorithm::StoreResults(AnalysisResult &result) {
+    return StoreSlices(mParams.template get<5>(), result);
+}
+
+bool AmpGateAlgorithm::RestoreResults(MediaItem *item, MediaItem_Take *take,
+                                      int numChannels, int sampleRate,
+                                      const AnalysisResult &result) {
+    if (!RestoreSlices(result, mParams.template get<5>(), sampleRate))
+        return false;
+    return HandleResults(item, take, numChannels, sampleRate);
+}
+
 const char *AmpGateAlgorithm::GetName() const { return "Onset Slice"; }
 
 int AmpGateAlgorithm::GetNumAlgorithmParams() const { return kNumParams; }
@@ -32,4 +32,7 @@ class AmpGateAlgorithm
                    int frameCount, int sampleRate) override;
     bool HandleResults(MediaItem *item, MediaItem_Take *take, int numChannels,
                        int sampleRate) override;
+    bool StoreResults(AnalysisResult &result) override;
+    bool RestoreResults(MediaItem *item, MediaItem_Take *take, int numChannels,
+                        int sampleRate, const AnalysisResult &result) override;
 };
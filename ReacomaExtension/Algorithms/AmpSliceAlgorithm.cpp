@@ -2,6 +2,7 @@
 #include "IPlugParameter.h"
 #include "ReacomaExtension.h"
 #include "flucoma/clients/common/ParameterTypes.hpp"
+#include "flucoma/clients/rt/AmpFeatureClient.hpp"
 #include "flucoma/clients/rt/AmpSliceClient.hpp"
 
 AmpSliceAlgorithm::AmpSliceAlgorithm(ReacomaExtension *apiProvider)
@@ -33,35 +34,124 @@ void AmpSliceAlgorithm::RegisterParameters() {
         ->InitInt("Minimum Slice Length (samples)", 1323, 1, 88200);
     mApiProvider->GetParam(mBaseParamIdx + kHiPassFreq)
         ->InitInt("High-Pass Filter Cutoff", 2000, 0, 10000);
+    // 0 slices at the on threshold; otherwise it is searched for, with the
+    // off threshold kept as far below it
+    mApiProvider->GetParam(mBaseParamIdx + kTargetSlices)
+        ->InitInt("Target Slices", 0, 0, 4096);
 }
 
 bool AmpSliceAlgorithm::DoProcess(InputBufferT::type &sourceBuffer,
                                   int numChannels, int frameCount,
                                   int sampleRate) {
+    auto fastRampUpTime = GetParamValue(kFastRampUpTime);
+    auto fastRampDownTime = GetParamValue(kFastRampDownTime);
+    auto slowRampUpTime = GetParamValue(kSlowRampUpTime);
+    auto slowRampDownTime = GetParamValue(kSlowRampDownTime);
+    auto onThreshold = GetParamValue(kOnThreshold);
+    auto offThreshold = GetParamValue(kOffThreshold);
+    auto floorValue = GetParamValue(kSilenceThreshold);
+    auto debounceTime = GetParamValue(kDebounce);
+    auto hiPassFreq = GetParamValue(kHiPassFreq);
+
+    const int targetSlices = GetParamInt(kTargetSlices);
+    if (targetSlices > 0) {
+        // The envelope difference, one value per sample, doesn't depend on
+        // the thresholds or the minimum slice length
+        Hasher hasher;
+        hasher.AddString("amp-curve");
+        hasher.AddValue(mSourceKey);
+        hasher.AddValue(fastRampUpTime);
+        hasher.AddValue(fastRampDownTime);
+        hasher.AddValue(slowRampUpTime);
+        hasher.AddValue(slowRampDownTime);
+        hasher.AddValue(floorValue);
+        hasher.AddValue(hiPassFreq);
+
+        // Both clients read the mixdown on the worker
+        auto mixdown = std::make_shared<std::vector<float>>(
+            MixDown(sourceBuffer, numChannels, frameCount));
+
+        auto computeCurve = [this, mixdown, frameCount, sampleRate,
+                             fastRampUpTime, fastRampDownTime, slowRampUpTime,
+                             slowRampDownTime, floorValue,
+                             hiPassFreq](std::vector<float> &curve) {
+            using FeatureClient = NRTThreadedAmpFeatureClient;
+            FluidContext context;
+            FeatureClient::ParamSetType params{
+                FeatureClient::getParameterDescriptors(),
+                FluidDefaultAllocator()};
+            auto features =
+                std::make_shared<MemoryBufferAdaptor>(1, 1, sampleRate);
+
+            params.template set<0>(
+                InputBufferT::type(new fluid::VectorBufferAdaptor(
+                    *mixdown, 1, frameCount, sampleRate)),
+                nullptr);
+            params.template set<1>(LongT::type(0), nullptr);
+            params.template set<2>(LongT::type(-1), nullptr);
+            params.template set<3>(LongT::type(0), nullptr);
+            params.template set<4>(LongT::type(-1), nullptr);
+            params.template set<5>(BufferT::type(features), nullptr);
+            params.template set<6>(LongT::type(fastRampUpTime), nullptr);
+            params.template set<7>(LongT::type(fastRampDownTime), nullptr);
+            params.template set<8>(LongT::type(slowRampUpTime), nullptr);
+            params.template set<9>(LongT::type(slowRampDownTime), nullptr);
+            params.template set<10>(FloatT::type(floorValue), nullptr);
+            params.template set<11>(FloatT::type(hiPassFreq), nullptr);
+
+            FeatureClient client(params, context);
+            if (!RunClient(client, params, 0.0, kCurveProgress))
+                return false;
+            return ReadCurve(params.template get<5>(), curve);
+        };
+
+        const double hysteresis = onThreshold - offThreshold;
+        auto slice = [this, mixdown, frameCount, sampleRate, fastRampUpTime,
+                      fastRampDownTime, slowRampUpTime, slowRampDownTime,
+                      hysteresis, floorValue, debounceTime,
+                      hiPassFreq](double sliceThreshold, BufferT::type slices) {
+            using SliceClient = NRTThreadedAmpSliceClient;
+            FluidContext context;
+            SliceClient::ParamSetType params{
+                SliceClient::getParameterDescriptors(),
+                FluidDefaultAllocator()};
+
+            params.template set<0>(
+                InputBufferT::type(new fluid::VectorBufferAdaptor(
+                    *mixdown, 1, frameCount, sampleRate)),
+                nullptr);
+            params.template set<1>(LongT::type(0), nullptr);
+            params.template set<2>(LongT::type(-1), nullptr);
+            params.template set<3>(LongT::type(0), nullptr);
+            params.template set<4>(LongT::type(-1), nullptr);
+            params.template set<5>(std::move(slices), nullptr);
+            params.template set<6>(LongT::type(fastRampUpTime), nullptr);
+            params.template set<7>(LongT::type(fastRampDownTime), nullptr);
+            params.template set<8>(LongT::type(slowRampUpTime), nullptr);
+            params.template set<9>(LongT::type(slowRampDownTime), nullptr);
+            params.template set<10>(FloatT::type(sliceThreshold), nullptr);
+            params.template set<11>(
+                FloatT::type(sliceThreshold - hysteresis), nullptr);
+            params.template set<12>(FloatT::type(floorValue), nullptr);
+            params.template set<13>(LongT::type(debounceTime), nullptr);
+            params.template set<14>(FloatT::type(hiPassFreq), nullptr);
+
+            SliceClient client(params, context);
+            return RunClient(client, params, kCurveProgress, 1.0);
+        };
+
+        return StartThresholdSearch(hasher.Get(), std::move(computeCurve),
+                                    std::move(slice), SliceRule::kHysteresis,
+                                    targetSlices,
+                                    static_cast<int>(debounceTime), sampleRate,
+                                    hysteresis);
+    }
+
     int estimatedSlices = std::max(1, static_cast<int>(frameCount / 1024.0));
     auto outBuffer =
         std::make_shared<MemoryBufferAdaptor>(1, estimatedSlices, sampleRate);
     auto slicesOutputBuffer = fluid::client::BufferT::type(outBuffer);
 
-    auto fastRampUpTime =
-        mApiProvider->GetParam(mBaseParamIdx + kFastRampUpTime)->Value();
-    auto fastRampDownTime =
-        mApiProvider->GetParam(mBaseParamIdx + kFastRampDownTime)->Value();
-    auto slowRampUpTime =
-        mApiProvider->GetParam(mBaseParamIdx + kSlowRampUpTime)->Value();
-    auto slowRampDownTime =
-        mApiProvider->GetParam(mBaseParamIdx + kSlowRampDownTime)->Value();
-    auto onThreshold =
-        mApiProvider->GetParam(mBaseParamIdx + kOnThreshold)->Value();
-    auto offThreshold =
-        mApiProvider->GetParam(mBaseParamIdx + kOffThreshold)->Value();
-    auto floorValue =
-        mApiProvider->GetParam(mBaseParamIdx + kSilenceThreshold)->Value();
-    auto debounceTime =
-        mApiProvider->GetParam(mBaseParamIdx + kDebounce)->Value();
-    auto hiPassFreq =
-        mApiProvider->GetParam(mBaseParamIdx + kHiPassFreq)->Value();
-
     mParams.template set<0>(std::move(sourceBuffer), nullptr);
     mParams.template set<1>(std::move(LongT::type(0)), nullptr);
     mParams.template set<2>(std::move(LongT::type(-1)), nullptr);
@@ -91,4 +181,10 @@ int AmpSliceAlgorithm::GetNumAlgorithmParams() const { return kNumParams; }
 
 BufferT::type &AmpSliceAlgorithm::GetSlicesBuffer() {
     return mParams.template get<5>();
-}
\ No newline at end of file
+}
+
+bool AmpSliceAlgorithm::IsParameterUsed(int algorithmParamEnum) const {
+    // A slice count is reached by searching for the on threshold
+    return algorithmParamEnum != kOnThreshold ||
+           GetParamInt(kTargetSlices) <= 0;
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include "flucoma/clients/rt/AmpFeatureClient.hpp"
 #include "flucoma/clients/rt/AmpSliceClient.hpp"
 #include "SlicingAlgorithm.h"
 
@@ -15,6 +16,7 @@ public:
         kSilenceThreshold,
         kDebounce,
         kHiPassFreq,
+        kTargetSlices,
         kNumParams
     };
 
@@ -27,6 +29,7 @@ public:
 
 protected:
     BufferT::type &GetSlicesBuffer() override;
+    bool IsParameterUsed(int algorithmParamEnum) const override;
     bool DoProcess(InputBufferT::type &sourceBuffer, int numChannels,
                    int frameCount, int sampleRate) override;
 };
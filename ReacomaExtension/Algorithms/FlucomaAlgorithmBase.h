@@ -2,23 +2,50 @@
 
 #include "../../dependencies/flucoma-core/include/flucoma/clients/common/FluidBaseClient.hpp"
 #include "../../dependencies/flucoma-core/include/flucoma/clients/common/FluidContext.hpp"
+#include "../../dependencies/flucoma-core/include/flucoma/clients/common/MemoryBufferAdaptor.hpp"
 #include "../../dependencies/flucoma-core/include/flucoma/clients/common/ParameterTypes.hpp"
 #include "../../dependencies/flucoma-core/include/flucoma/clients/common/Result.hpp"
 #include "../VectorBufferAdaptor.h"
+#include "AnalysisCache.h"
+#include "Hasher.h"
 #include "IAlgorithm.h"
+#include "OutputQueue.h"
+#include "PeakBuilder.h"
+#include "PreviewTakes.h"
+#include "ReacomaExtension.h"
+#include "ResultMemo.h"
 
 #include "wdltypes.h"
 #include "reaper_plugin_functions.h"
 
+#include <atomic>
+#include <chrono>
 #include <filesystem>
-#include <iomanip>
-#include <sstream>
+#include <functional>
+#include <thread>
 
 using namespace fluid;
 using namespace client;
 
 class ReacomaExtension;
 
+// Stands in for the client of algorithms that do all of their processing
+// through StartWorker(), so that none is constructed
+class WorkerOnlyClient {
+public:
+    struct ParamSetType {
+        template <typename... Args> ParamSetType(Args &&...) {}
+    };
+
+    static int getParameterDescriptors() { return 0; }
+
+    WorkerOnlyClient(ParamSetType &, FluidContext &) {}
+
+    ProcessState checkProgress(Result &) { return ProcessState::kDone; }
+    double progress() const { return 1.0; }
+    void cancel() {}
+};
+
 template <typename ClientType> class FlucomaAlgorithm : public IAlgorithm {
 public:
     FlucomaAlgorithm(ReacomaExtension *apiProvider)
@@ -27,7 +54,7 @@ public:
                   FluidDefaultAllocator()},
           mClient{mParams, mContext} {}
 
-    virtual ~FlucomaAlgorithm() override = default;
+    virtual ~FlucomaAlgorithm() override { StopWorker(); }
 
     bool StartProcessItemAsync(MediaItem *item) override final {
 
@@ -39,7 +66,9 @@ public:
         mIsFinishedFlag = false;
         mProgress = 0.0;
 
-        MediaItem_Take *take = GetActiveTake(item);
+        // While a preview take is showing, the item is still processed
+        // from the take the preview was made from
+        MediaItem_Take *take = mApiProvider->GetInputTake(item);
         if (!take)
             return false;
 
@@ -64,6 +93,18 @@ public:
         if (frameCount <= 0 || numChannels <= 0)
             return false;
 
+        mItemForAsync = item;
+        mTakeForAsync = take;
+        mNumChannelsForAsync = numChannels;
+        mSampleRateForAsync = sampleRate;
+
+        // Sources are identified without reading any audio, so an unchanged
+        // item costs a single cache lookup
+        mSourceKey = HashSourceRange(source, takeOffset, frameCount,
+                                     sampleRate, numChannels);
+        if (RestoreFromCache(mSourceKey))
+            return true;
+
         std::vector<double> allChannelsAsDouble(frameCount * numChannels);
         PCM_source_transfer_t transfer{};
         transfer.time_s = takeOffset;
@@ -78,11 +119,6 @@ public:
         auto inputBuffer = InputBufferT::type(new fluid::VectorBufferAdaptor(
             allChannelsAsFloat, numChannels, frameCount, sampleRate));
 
-        mItemForAsync = item;
-        mTakeForAsync = take;
-        mNumChannelsForAsync = numChannels;
-        mSampleRateForAsync = sampleRate;
-
         if (!DoProcess(inputBuffer, numChannels, frameCount, sampleRate)) {
             return false;
         }
@@ -93,6 +129,17 @@ public:
     bool IsFinished() override final {
         if (mIsFinishedFlag)
             return true;
+
+        if (mUsesWorker) {
+            mProgress = mWorkerProgress;
+            if (mWorkerDone) {
+                mWorker.join();
+                mIsFinishedFlag = true;
+                mProgress = 1.0;
+            }
+            return mIsFinishedFlag;
+        }
+
         Result result;
         ProcessState processState = mClient.checkProgress(result);
         mProgress = mClient.progress();
@@ -109,8 +156,23 @@ public:
         if (!mItemForAsync || item != mItemForAsync)
             return false;
 
-        bool success = HandleResults(mItemForAsync, mTakeForAsync,
-                                     mNumChannelsForAsync, mSampleRateForAsync);
+        bool success = false;
+        if (mHasCachedResult) {
+            success = RestoreResults(mItemForAsync, mTakeForAsync,
+                                     mNumChannelsForAsync, mSampleRateForAsync,
+                                     mCachedResult);
+        } else if (!mUsesWorker || mWorkerSucceeded) {
+            success = HandleResults(mItemForAsync, mTakeForAsync,
+                                    mNumChannelsForAsync, mSampleRateForAsync);
+
+            AnalysisResult result;
+            if (success && mCacheKey != 0 && StoreResults(result)) {
+                mApiProvider->GetResultMemo()->Store(mCacheKey, result);
+                AnalysisCache *cache = mApiProvider->GetAnalysisCache();
+                if (cache && !result.HoldsAudio())
+                    cache->Store(mCacheKey, result);
+            }
+        }
 
         mItemForAsync = nullptr;
         mTakeForAsync = nullptr;
@@ -124,7 +186,12 @@ public:
         return success;
     }
 
-    void Cancel() override final { mClient.cancel(); }
+    void Cancel() override final {
+        if (mUsesWorker)
+            mWorkerCancelled = true;
+        else
+            mClient.cancel();
+    }
 
     double GetProgress() override final { return mProgress; }
 
@@ -132,6 +199,10 @@ public:
 
     bool SupportsRegions() override { return true; }
 
+    bool SupportsSplitting() override { return false; }
+
+    bool WritesCurve() override { return false; }
+
     bool CreatesTakes() override { return false; }
 
 protected:
@@ -142,18 +213,189 @@ protected:
     virtual bool HandleResults(MediaItem *item, MediaItem_Take *take,
                                int numChannels, int sampleRate) = 0;
 
+    // Cache support. Algorithms that can describe their outcome as an
+    // AnalysisResult override these; the defaults opt out of caching.
+    virtual bool StoreResults(AnalysisResult &result) { return false; }
+    virtual bool CanRestoreResults(const AnalysisResult &result) {
+        return true;
+    }
+    virtual bool RestoreResults(MediaItem *item, MediaItem_Take *take,
+                                int numChannels, int sampleRate,
+                                const AnalysisResult &result) {
+        return false;
+    }
+
+    // Settings outside the algorithm's own parameters that change its
+    // output, folded into the cache key
+    virtual uint64_t HashOutputSettings() { return 0; }
+
+    static bool StoreSlices(BufferT::type &slices, AnalysisResult &result) {
+        BufferAdaptor::ReadAccess reader(slices.get());
+        if (!reader.exists() || !reader.valid())
+            return false;
+
+        result.slices.assign(reader.numChans(), {});
+        for (fluid::index c = 0; c < reader.numChans(); c++) {
+            auto view = reader.samps(c);
+            result.slices[c].assign(view.begin(), view.end());
+        }
+        return true;
+    }
+
+    static bool RestoreSlices(const AnalysisResult &result,
+                              BufferT::type &slices, int sampleRate) {
+        if (result.slices.empty())
+            return false;
+
+        size_t numFrames = 1;
+        for (const auto &channel : result.slices)
+            numFrames = std::max(numFrames, channel.size());
+
+        auto buffer = std::make_shared<MemoryBufferAdaptor>(
+            result.slices.size(), numFrames, sampleRate);
+        BufferAdaptor::Access writer(buffer.get());
+        if (!writer.exists() || !writer.valid())
+            return false;
+
+        for (size_t c = 0; c < result.slices.size(); c++) {
+            auto view = writer.samps(c);
+            for (size_t i = 0; i < numFrames; i++)
+                view(i) = i < result.slices[c].size()
+                              ? static_cast<float>(result.slices[c][i])
+                              : -1.f;
+        }
+        slices = BufferT::type(buffer);
+        return true;
+    }
+
+    // Runs processing that does not go through the flucoma client on a thread
+    // of its own; IsFinished(), GetProgress() and Cancel() then follow the
+    // worker instead of the client. The work must not touch members of the
+    // derived class, which are destroyed before the worker is joined, and
+    // should poll IsWorkerCancelled() between steps.
+    void StartWorker(std::function<bool()> work) {
+        StopWorker();
+        mUsesWorker = true;
+        mWorkerCancelled = false;
+        mWorkerSucceeded = false;
+        mWorkerDone = false;
+        mWorkerProgress = 0.0;
+        mWorker = std::thread([this, work = std::move(work)] {
+            mWorkerSucceeded = work();
+            mWorkerDone = true;
+        });
+    }
+
+    void StopWorker() {
+        if (mWorker.joinable()) {
+            mWorkerCancelled = true;
+            mWorker.join();
+        }
+    }
+
+    bool IsWorkerCancelled() const { return mWorkerCancelled; }
+    void SetWorkerProgress(double progress) { mWorkerProgress = progress; }
+
 protected:
     FluidContext mContext;
     typename ClientType::ParamSetType mParams;
     ClientType mClient;
 
+    // Identifies the audio being processed; valid from DoProcess() onwards
+    // and used to key intermediate stages kept between runs
+    uint64_t mSourceKey = 0;
+
 private:
+    // Identifies the audio a take reads without reading any of it, so that
+    // even a long item costs a single cache lookup on the main thread.
+    // Sections are followed to the source they cut from, and file sources
+    // are identified by name, size and modification time. Other sources,
+    // such as in-memory ones, have nothing that outlives them, so they are
+    // identified by address for the current session only.
+    static uint64_t HashSourceRange(PCM_source *source, double takeOffset,
+                                    int frameCount, int sampleRate,
+                                    int numChannels) {
+        Hasher hasher;
+        hasher.AddValue(takeOffset);
+        hasher.AddValue(frameCount);
+        hasher.AddValue(sampleRate);
+        hasher.AddValue(numChannels);
+
+        while (PCM_source *parent = GetMediaSourceParent(source)) {
+            double sectionOffset = 0.0;
+            double sectionLength = 0.0;
+            bool reversed = false;
+            PCM_Source_GetSectionInfo(source, &sectionOffset, &sectionLength,
+                                      &reversed);
+            hasher.AddValue(sectionOffset);
+            hasher.AddValue(sectionLength);
+            hasher.AddValue(reversed);
+            source = parent;
+        }
+
+        char fileName[4096] = "";
+        GetMediaSourceFileName(source, fileName, sizeof(fileName));
+        std::error_code ec;
+        std::filesystem::path path(fileName);
+        const auto fileSize = std::filesystem::file_size(path, ec);
+        const auto modified = ec ? std::filesystem::file_time_type()
+                                 : std::filesystem::last_write_time(path, ec);
+        if (fileName[0] != '\0' && !ec) {
+            hasher.AddString(fileName);
+            hasher.AddValue(static_cast<uint64_t>(fileSize));
+            hasher.AddValue(modified.time_since_epoch().count());
+        } else {
+            // Never matches an entry stored on disk by an earlier session
+            static const auto session =
+                std::chrono::steady_clock::now().time_since_epoch().count();
+            hasher.AddValue(session);
+            hasher.AddValue(source);
+            hasher.AddValue(source->GetLength());
+        }
+        return hasher.Get();
+    }
+
+    bool RestoreFromCache(uint64_t sourceKey) {
+        Hasher hasher;
+        hasher.AddValue(sourceKey);
+        hasher.AddString(GetName());
+        hasher.AddValue(HashParameters());
+        hasher.AddValue(HashOutputSettings());
+        mCacheKey = hasher.Get();
+
+        ResultMemo *memo = mApiProvider->GetResultMemo();
+        if (!memo->Lookup(mCacheKey, mCachedResult)) {
+            AnalysisCache *cache = mApiProvider->GetAnalysisCache();
+            if (!cache || !cache->Lookup(mCacheKey, mCachedResult))
+                return false;
+            memo->Store(mCacheKey, mCachedResult);
+        }
+        if (!CanRestoreResults(mCachedResult))
+            return false;
+
+        mHasCachedResult = true;
+        mIsFinishedFlag = true;
+        mProgress = 1.0;
+        return true;
+    }
+
+    uint64_t mCacheKey = 0;
+    AnalysisResult mCachedResult;
+    bool mHasCachedResult = false;
+
     MediaItem *mItemForAsync = nullptr;
     MediaItem_Take *mTakeForAsync = nullptr;
     int mNumChannelsForAsync = 0;
     int mSampleRateForAsync = 0;
     bool mIsFinishedFlag = false;
     double mProgress = 0.0;
+
+    std::thread mWorker;
+    bool mUsesWorker = false;
+    std::atomic<bool> mWorkerCancelled{false};
+    std::atomic<bool> mWorkerSucceeded{false};
+    std::atomic<bool> mWorkerDone{false};
+    std::atomic<double> mWorkerProgress{0.0};
 };
 
 template <typename ClientType>
@@ -164,87 +406,237 @@ protected:
     AudioOutputAlgorithm(ReacomaExtension *apiProvider)
         : FlucomaAlgorithm<ClientType>(apiProvider) {}
 
+    // A take reading the output file, possibly only some of its channels
+    struct OutputTake {
+        std::string takeSuffix;
+        // I_CHANMODE of the take
+        int channelMode = 0;
+    };
+
     void AddOutputToTake(MediaItem *item, BufferT::type output, int sampleRate,
                          const std::string &suffix) {
-        if (!output)
+        AddOutputToTakes(item, std::move(output), sampleRate, suffix, {},
+                         {OutputTake{}});
+    }
+
+    // Writes the channels of output listed in channelMap, in that order, to
+    // a single file (all channels if channelMap is empty) and adds one take
+    // per entry of takes reading it
+    void AddOutputToTakes(MediaItem *item, BufferT::type output,
+                          int sampleRate, const std::string &suffix,
+                          std::vector<int> channelMap,
+                          const std::vector<OutputTake> &takes) {
+        if (!output || takes.empty())
             return;
 
-        fluid::client::BufferAdaptor::ReadAccess bufferReader(output.get());
-        if (!bufferReader.exists() || !bufferReader.valid())
+        int numChans = 0;
+        {
+            fluid::client::BufferAdaptor::ReadAccess bufferReader(
+                output.get());
+            if (!bufferReader.exists() || !bufferReader.valid())
+                return;
+            numChans = static_cast<int>(bufferReader.numChans());
+        }
+        if (channelMap.empty()) {
+            for (int c = 0; c < numChans; c++)
+                channelMap.push_back(c);
+        }
+        for (int channel : channelMap) {
+            if (channel < 0 || channel >= numChans)
+                return;
+        }
+
+        if (mApiProvider->IsPreviewing()) {
+            ShowPreview(item, output, numChans, sampleRate, suffix,
+                        channelMap, takes);
             return;
+        }
+
+        const EOutputFormat format = mApiProvider->GetOutputFormat();
+        std::string takeName;
+        const std::string outputPath = mApiProvider->MakeOutputPath(
+            mApiProvider->GetInputTake(item), suffix, takeName);
+
+        // The file is written in the background; the takes are added on the
+        // main thread once it is complete, if the item still exists
+        OutputQueue::Request request;
+        request.path = outputPath;
+        request.numChans = static_cast<int>(channelMap.size());
+        request.sampleRate = sampleRate;
+        request.format = format;
+        request.render = [output, channelMap](OutputWriter &writer,
+                                              PCM_sink *sink) {
+            fluid::client::BufferAdaptor::ReadAccess reader(output.get());
+            if (!reader.exists() || !reader.valid())
+                return false;
+            writer.Write(sink, reader.allFrames().data(),
+                         static_cast<int>(reader.numFrames()),
+                         static_cast<int>(reader.numChans()), channelMap);
+            return true;
+        };
+        request.hashContent = [output, channelMap]() {
+            Hasher hasher;
+            fluid::client::BufferAdaptor::ReadAccess reader(output.get());
+            if (!reader.exists() || !reader.valid())
+                return uint64_t(0);
+            const size_t numSamples = reader.numFrames() * reader.numChans();
+            hasher.Add(reader.allFrames().data(), numSamples * sizeof(float));
+            for (int channel : channelMap)
+                hasher.AddValue(channel);
+            return hasher.Get();
+        };
 
-        auto numFrames = bufferReader.numFrames();
-        auto numChans = bufferReader.numChans();
+        std::vector<AnalysisResult::Output> outputs;
+        for (const auto &take : takes)
+            outputs.push_back({outputPath, takeName + take.takeSuffix, suffix,
+                               take.takeSuffix, take.channelMode});
+        request.onComplete = [item, outputs,
+                              peaks = mApiProvider->GetPeakBuilder()](bool ok) {
+            if (!ok || !ValidatePtr2(nullptr, item, "MediaItem*"))
+                return;
+            for (const auto &output : outputs)
+                peaks->Add(AddTakeFromFile(item, output));
+        };
+        mApiProvider->GetOutputQueue()->Submit(std::move(request));
 
-        std::vector<std::vector<ReaSample>> channelData(
-            numChans, std::vector<ReaSample>(numFrames));
-        std::vector<ReaSample *> pointerArray(numChans);
-        const float *sourceData = bufferReader.allFrames().data();
+        mWrittenOutputs.insert(mWrittenOutputs.end(), outputs.begin(),
+                               outputs.end());
+    }
 
-        for (int i = 0; i < numChans; ++i) {
-            for (int j = 0; j < numFrames; ++j) {
-                channelData[i][j] =
-                    static_cast<ReaSample>(sourceData[j * numChans + i]);
-            }
-            pointerArray[i] = channelData[i].data();
-        }
-
-        char originalFilePathCStr[4096] = "";
-        auto activeTake = GetActiveTake(item);
-        if (activeTake) {
-            auto takeSource = GetMediaItemTake_Source(activeTake);
-            if (takeSource) {
-                auto srcParent = GetMediaSourceParent(takeSource);
-                GetMediaSourceFileName(srcParent ? srcParent : takeSource,
-                                       originalFilePathCStr,
-                                       sizeof(originalFilePathCStr));
+    // Auto-process shows results from memory; nothing is written until the
+    // previews are committed. The takes of one output share a single copy.
+    void ShowPreview(MediaItem *item, BufferT::type &output, int numChans,
+                     int sampleRate, const std::string &suffix,
+                     const std::vector<int> &channelMap,
+                     const std::vector<OutputTake> &takes) {
+        const size_t numOutputChans = channelMap.size();
+        auto audio = std::make_shared<std::vector<float>>();
+        {
+            fluid::client::BufferAdaptor::ReadAccess reader(output.get());
+            if (!reader.exists() || !reader.valid())
+                return;
+            const size_t numFrames = reader.numFrames();
+            const float *samples = reader.allFrames().data();
+            audio->resize(numFrames * numOutputChans);
+            for (size_t f = 0; f < numFrames; f++) {
+                for (size_t c = 0; c < numOutputChans; c++)
+                    (*audio)[f * numOutputChans + c] =
+                        samples[f * numChans + channelMap[c]];
             }
         }
 
-        auto now = std::chrono::system_clock::now();
-        auto in_time_t = std::chrono::system_clock::to_time_t(now);
-        std::stringstream ss;
-        ss << std::put_time(std::localtime(&in_time_t), "%Y%m%d%H%M%S");
+        for (const auto &take : takes) {
+            PreviewTakes::Preview preview;
+            preview.item = item;
+            preview.inputTake = mApiProvider->GetInputTake(item);
+            preview.suffix = suffix;
+            preview.takeSuffix = take.takeSuffix;
+            preview.channelMode = take.channelMode;
+            preview.audio = audio;
+            preview.numChans = static_cast<int>(numOutputChans);
+            preview.sampleRate = sampleRate;
+            mApiProvider->GetPreviewTakes()->ShowAudio(std::move(preview));
+
+            // Memoised with the audio, so that going back to these
+            // settings shows it again without processing
+            AnalysisResult::Output shown;
+            shown.suffix = suffix;
+            shown.takeSuffix = take.takeSuffix;
+            shown.channelMode = take.channelMode;
+            shown.audio = audio;
+            shown.numChans = static_cast<int>(numOutputChans);
+            shown.sampleRate = sampleRate;
+            mWrittenOutputs.push_back(std::move(shown));
+        }
+    }
 
-        std::filesystem::path originalPath(originalFilePathCStr);
-        auto parentDir = originalPath.parent_path();
-        auto stem = originalPath.stem().string();
+    // Returns the new take, or nullptr if it couldn't be created
+    static MediaItem_Take *
+    AddTakeFromFile(MediaItem *item, const AnalysisResult::Output &output) {
+        PCM_source *newSource = PCM_Source_CreateFromFile(output.path.c_str());
+        if (!newSource)
+            return nullptr;
+
+        MediaItem_Take *newTake = AddTakeToMediaItem(item);
+        if (!newTake) {
+            delete newSource;
+            return nullptr;
+        }
 
-        std::filesystem::path reacomaFolder = parentDir / "reacoma";
-        std::filesystem::create_directory(reacomaFolder);
+        GetSetMediaItemTakeInfo(newTake, "P_SOURCE", newSource);
+        GetSetMediaItemTakeInfo(newTake, "P_NAME",
+                                (char *)output.takeName.c_str());
+        if (output.channelMode != 0)
+            SetMediaItemTakeInfo_Value(newTake, "I_CHANMODE",
+                                       output.channelMode);
+        return newTake;
+    }
 
-        std::string takeName = stem + "_" + ss.str() + "_" + suffix;
-        std::string newFilename = takeName + ".wav";
-        std::filesystem::path outputFilePath = reacomaFolder / newFilename;
+    uint64_t HashOutputSettings() override {
+        return static_cast<uint64_t>(mApiProvider->GetOutputFormat());
+    }
 
-        struct WavConfig {
-            char fourcc[4];
-            int bit_depth;
-        };
-        WavConfig config;
-        memcpy(config.fourcc, "evaw", 4);
-        config.bit_depth = 32;
-
-        PCM_sink *sink = PCM_Sink_CreateEx(
-            nullptr, outputFilePath.string().c_str(), (const char *)&config,
-            sizeof(config), numChans, sampleRate, true);
-        if (sink) {
-            sink->WriteDoubles(pointerArray.data(), numFrames, numChans, 0, 1);
-            delete sink;
-        }
-
-        PCM_source *newSource =
-            PCM_Source_CreateFromFile(outputFilePath.u8string().c_str());
-        if (newSource) {
-            MediaItem_Take *newTake = AddTakeToMediaItem(item);
-            if (newTake) {
-                GetSetMediaItemTakeInfo(newTake, "P_SOURCE", newSource);
-                GetSetMediaItemTakeInfo(newTake, "P_NAME",
-                                        (char *)takeName.c_str());
+    bool StoreResults(AnalysisResult &result) override {
+        if (mWrittenOutputs.empty())
+            return false;
+        result.outputs = mWrittenOutputs;
+        return true;
+    }
+
+    // Rendered files may have been deleted or moved since they were cached.
+    // Preview audio can only be shown as another preview, as it has no file
+    // for a take to read.
+    bool CanRestoreResults(const AnalysisResult &result) override {
+        if (result.outputs.empty())
+            return false;
+        std::error_code ec;
+        for (const auto &output : result.outputs) {
+            if (output.audio) {
+                if (!mApiProvider->IsPreviewing())
+                    return false;
+            } else if (!std::filesystem::exists(
+                           std::filesystem::u8path(output.path), ec)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool RestoreResults(MediaItem *item, MediaItem_Take *take, int numChannels,
+                        int sampleRate, const AnalysisResult &result) override {
+        bool success = true;
+        for (const auto &output : result.outputs) {
+            if (mApiProvider->IsPreviewing()) {
+                PreviewTakes::Preview preview;
+                preview.item = item;
+                preview.inputTake = take;
+                preview.suffix = output.suffix;
+                preview.takeSuffix = output.takeSuffix;
+                preview.channelMode = output.channelMode;
+                PreviewTakes *previews = mApiProvider->GetPreviewTakes();
+                if (output.audio) {
+                    preview.audio = output.audio;
+                    preview.numChans = output.numChans;
+                    preview.sampleRate = output.sampleRate;
+                    success =
+                        previews->ShowAudio(std::move(preview)) && success;
+                } else {
+                    preview.path = output.path;
+                    success = previews->ShowFile(std::move(preview)) && success;
+                }
+            } else {
+                MediaItem_Take *newTake = AddTakeFromFile(item, output);
+                mApiProvider->GetPeakBuilder()->Add(newTake);
+                success = newTake && success;
             }
         }
+        return success;
     }
 
+private:
+    // Files written, or previews shown from memory, for StoreResults()
+    std::vector<AnalysisResult::Output> mWrittenOutputs;
+
 public:
     bool SupportsSegmentation() { return false; }
     bool SupportsRegions() { return false; }
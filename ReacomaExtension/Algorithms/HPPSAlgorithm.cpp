@@ -1,9 +1,11 @@
 #include "HPSSAlgorithm.h"
+#include "HPSSSeparation.h"
 #include "IPlugParameter.h"
 #include "ReacomaExtension.h"
+#include "StageCache.h"
 
 HPSSAlgorithm::HPSSAlgorithm(ReacomaExtension *apiProvider)
-    : AudioOutputAlgorithm<NRTThreadedHPSSClient>(apiProvider) {}
+    : AudioOutputAlgorithm<WorkerOnlyClient>(apiProvider) {}
 
 HPSSAlgorithm::~HPSSAlgorithm() = default;
 
@@ -32,74 +34,94 @@ void HPSSAlgorithm::RegisterParameters() {
 
 bool HPSSAlgorithm::DoProcess(InputBufferT::type &sourceBuffer, int numChannels,
                               int frameCount, int sampleRate) {
-    auto harmFilterSizeParam =
-        mApiProvider->GetParam(mBaseParamIdx + HPSSAlgorithm::kHarmFilterSize)
-            ->Value();
-    auto percFilterSizeParam =
-        mApiProvider->GetParam(mBaseParamIdx + HPSSAlgorithm::kPercFilterSize)
-            ->Value();
-
-    auto windowSize =
-        mApiProvider->GetParam(mBaseParamIdx + HPSSAlgorithm::kWindowSize)
-            ->Value();
-    auto hopSize =
-        mApiProvider->GetParam(mBaseParamIdx + HPSSAlgorithm::kHopSize)
-            ->Value();
-    auto fftSize =
-        mApiProvider->GetParam(mBaseParamIdx + HPSSAlgorithm::kFFTSize)
-            ->Value();
-
-    auto harmMemoryBuffer =
-        std::make_shared<MemoryBufferAdaptor>(1, frameCount, sampleRate);
-    auto percMemoryBuffer =
-        std::make_shared<MemoryBufferAdaptor>(1, frameCount, sampleRate);
-    auto harmOutputBuffer = fluid::client::BufferT::type(harmMemoryBuffer);
-    auto percOutputBuffer = fluid::client::BufferT::type(percMemoryBuffer);
-
-    if (static_cast<int>(harmFilterSizeParam) % 2 == 0)
-        harmFilterSizeParam += 1;
-    if (static_cast<int>(percFilterSizeParam) % 2 == 0)
-        percFilterSizeParam += 1;
-
-    mParams.template set<0>(std::move(sourceBuffer), nullptr);   // source
-    mParams.template set<1>(std::move(LongT::type(0)), nullptr);       // startChan
-    mParams.template set<2>(std::move(LongT::type(-1)), nullptr);       // numChans
-    mParams.template set<3>(std::move(LongT::type(0)), nullptr);       // startFrame
-    mParams.template set<4>(std::move(LongT::type(-1)), nullptr);       // numFrames
-    mParams.template set<5>(std::move(harmOutputBuffer), nullptr); // harmonic
-    mParams.template set<6>(std::move(percOutputBuffer), nullptr); // percussive
-    mParams.template set<7>(nullptr, nullptr);
-    mParams.template set<8>(
-        std::move(LongRuntimeMaxParam(harmFilterSizeParam, harmFilterSizeParam)), nullptr);
-    mParams.template set<9>(
-        std::move(LongRuntimeMaxParam(percFilterSizeParam, percFilterSizeParam)), nullptr);
-    mParams.template set<10>(std::move(LongT::type(0)), nullptr);
-    mParams.template set<11>(std::move(FloatPairsArrayT::type(0, 1, 1, 1)), nullptr);
-    mParams.template set<12>(std::move(FloatPairsArrayT::type(1, 0, 1, 1)), nullptr);
-    mParams.template set<13>(
-        std::move(fluid::client::FFTParams(windowSize, hopSize, fftSize,
-                                           std::max(windowSize, fftSize))),
-        nullptr);
-
-    mClient = NRTThreadedHPSSClient(mParams, mContext);
-    mClient.setSynchronous(false);
-    mClient.enqueue(mParams);
-    Result result = mClient.process();
-
-    if (!result.ok()) {
-        ShowConsoleMsg("NMF processing failed.\n");
-        return false;
+    auto harmFilterSizeParam = GetParamValue(HPSSAlgorithm::kHarmFilterSize);
+    auto percFilterSizeParam = GetParamValue(HPSSAlgorithm::kPercFilterSize);
+
+    auto windowSize = GetParamValue(HPSSAlgorithm::kWindowSize);
+    auto hopSize = GetParamValue(HPSSAlgorithm::kHopSize);
+    auto fftSize = GetParamValue(HPSSAlgorithm::kFFTSize);
+
+    const int harmFilterSize = static_cast<int>(harmFilterSizeParam) | 1;
+    const int percFilterSize = static_cast<int>(percFilterSizeParam) | 1;
+    const int window = static_cast<int>(windowSize);
+    const int hop = static_cast<int>(hopSize);
+    const int fft = static_cast<int>(fftSize);
+
+    Hasher stageHasher;
+    stageHasher.AddString("hpss-stft");
+    stageHasher.AddValue(mSourceKey);
+    stageHasher.AddValue(window);
+    stageHasher.AddValue(hop);
+    stageHasher.AddValue(fft);
+    const uint64_t stageKey = stageHasher.Get();
+
+    StageCache *stageCache = mApiProvider->GetStageCache();
+    auto spectrogram = stageCache->Get<HPSSSpectrogram>(stageKey);
+
+    // The source buffer views audio owned by the caller, so the worker only
+    // gets a copy of it when the spectrogram has to be computed
+    std::vector<float> audio;
+    if (!spectrogram) {
+        BufferAdaptor::ReadAccess reader(sourceBuffer.get());
+        if (!reader.exists() || !reader.valid())
+            return false;
+        audio.resize(static_cast<size_t>(numChannels) * frameCount);
+        for (int c = 0; c < numChannels; c++) {
+            auto samples = reader.samps(c);
+            float *channel = audio.data() + static_cast<size_t>(c) * frameCount;
+            for (int i = 0; i < frameCount; i++)
+                channel[i] = samples(i);
+        }
     }
+
+    auto harmMemoryBuffer = std::make_shared<MemoryBufferAdaptor>(
+        numChannels, frameCount, sampleRate);
+    auto percMemoryBuffer = std::make_shared<MemoryBufferAdaptor>(
+        numChannels, frameCount, sampleRate);
+    mHarmonicOutput = fluid::client::BufferT::type(harmMemoryBuffer);
+    mPercussiveOutput = fluid::client::BufferT::type(percMemoryBuffer);
+
+    StartWorker([this, spectrogram, audio = std::move(audio), numChannels,
+                 frameCount, harmFilterSize, percFilterSize, window, hop,
+                 fft, stageKey, stageCache, harmMemoryBuffer,
+                 percMemoryBuffer]() mutable {
+        if (!spectrogram) {
+            spectrogram = AnalyseHPSS(audio, numChannels, frameCount, window,
+                                      hop, fft, [this](double fraction) {
+                                          SetWorkerProgress(0.3 * fraction);
+                                          return !IsWorkerCancelled();
+                                      });
+            if (!spectrogram)
+                return false;
+            stageCache->Put(stageKey, spectrogram, spectrogram->GetBytes());
+        }
+        SetWorkerProgress(0.3);
+
+        BufferAdaptor::Access harmonic(harmMemoryBuffer.get());
+        BufferAdaptor::Access percussive(percMemoryBuffer.get());
+        if (!harmonic.exists() || !percussive.exists())
+            return false;
+
+        for (int c = 0; c < numChannels; c++) {
+            auto onProgress = [this, c, numChannels](double fraction) {
+                SetWorkerProgress(0.3 + 0.7 * (c + fraction) / numChannels);
+                return !IsWorkerCancelled();
+            };
+            if (!SeparateHPSS(spectrogram->channels[c], frameCount, window,
+                              hop, fft, harmFilterSize, percFilterSize,
+                              harmonic.samps(c), percussive.samps(c),
+                              onProgress))
+                return false;
+        }
+        return true;
+    });
     return true;
 }
 
 bool HPSSAlgorithm::HandleResults(MediaItem *item, MediaItem_Take *take,
                                   int numChannels, int sampleRate) {
-    auto harmOutputBuffer = mParams.template get<5>();
-    auto percOutputBuffer = mParams.template get<6>();
-
-    AddOutputToTake(item, harmOutputBuffer, sampleRate, "harmonic");
-    AddOutputToTake(item, percOutputBuffer, sampleRate, "percussive");
+    AddOutputToTake(item, mHarmonicOutput, sampleRate, "harmonic");
+    AddOutputToTake(item, mPercussiveOutput, sampleRate, "percussive");
     return true;
 }
 
@@ -1,9 +1,7 @@
 #pragma once
-#include "../../dependencies/flucoma-core/include/flucoma/clients/rt/HPSSClient.hpp"
 #include "FlucomaAlgorithmBase.h"
 
-class HPSSAlgorithm
-    : public AudioOutputAlgorithm<fluid::client::NRTThreadedHPSSClient> {
+class HPSSAlgorithm : public AudioOutputAlgorithm<WorkerOnlyClient> {
   public:
     enum Params {
         kHarmFilterSize = 0,
@@ -26,4 +24,11 @@ class HPSSAlgorithm
                    int frameCount, int sampleRate) override;
     bool HandleResults(MediaItem *item, MediaItem_Take *take, int numChannels,
                        int sampleRate) override;
+
+  private:
+    // Separation runs flucoma's STFT, HPSS and ISTFT on a worker rather than
+    // through the streaming client, with the spectrogram cached per item, so
+    // filter size changes only redo the HPSS and inverse transform
+    BufferT::type mHarmonicOutput;
+    BufferT::type mPercussiveOutput;
 };
@@ -1,6 +1,46 @@
 #include "IAlgorithm.h"
+#include "Hasher.h"
+#include "ReacomaExtension.h"
 
 IAlgorithm::IAlgorithm(ReacomaExtension *apiProvider)
     : mApiProvider(apiProvider) {}
 
 IAlgorithm::~IAlgorithm() = default;
+
+uint64_t IAlgorithm::HashParameters() const {
+    ParameterSnapshot live;
+    if (!mParameters)
+        live = ParameterSnapshot::Capture(mApiProvider, *this);
+    const ParameterSnapshot &parameters = mParameters ? *mParameters : live;
+
+    std::vector<int> used;
+    for (int i = 0; i < parameters.GetNumParams(); ++i) {
+        if (IsParameterUsed(i))
+            used.push_back(i);
+    }
+    if (static_cast<int>(used.size()) == parameters.GetNumParams())
+        return parameters.GetHash();
+
+    Hasher hasher;
+    hasher.AddValue(parameters.GetNumParams());
+    for (int i : used) {
+        hasher.AddValue(i);
+        hasher.AddValue(parameters.Get(i));
+    }
+    return hasher.Get();
+}
+
+double IAlgorithm::GetParamValue(int algorithmParamEnum) const {
+    if (mParameters)
+        return mParameters->Get(algorithmParamEnum);
+    return mApiProvider->GetParam(GetGlobalParamIdx(algorithmParamEnum))
+        ->Value();
+}
+
+int IAlgorithm::GetParamInt(int algorithmParamEnum) const {
+    return static_cast<int>(GetParamValue(algorithmParamEnum));
+}
+
+bool IAlgorithm::GetParamBool(int algorithmParamEnum) const {
+    return GetParamValue(algorithmParamEnum) >= 0.5;
+}
@@ -1,7 +1,10 @@
 #pragma once
+#include <cstdint>
 #include <memory>
 #include <vector>
 
+#include "ParameterSnapshot.h"
+
 class MediaItem;
 class ReacomaExtension;
 
@@ -25,12 +28,33 @@ class IAlgorithm {
     virtual int GetNumAlgorithmParams() const = 0;
     int GetBaseParamIdx() const { return mBaseParamIdx; }
     void SetBaseParamIdx(int idx) { mBaseParamIdx = idx; }
+    // Hash of the parameters that affect the outcome with the current
+    // values, so that changing an ignored one still finds cached results
+    uint64_t HashParameters() const;
+
+    // Parameters the algorithm reads while processing; until set, the live
+    // values are read
+    void SetParameters(std::shared_ptr<const ParameterSnapshot> parameters) {
+        mParameters = std::move(parameters);
+    }
 
     virtual bool SupportsSegmentation() = 0;
     virtual bool SupportsRegions() = 0;
+    virtual bool SupportsSplitting() = 0;
+    // Draws a feature curve on the item rather than slicing it
+    virtual bool WritesCurve() = 0;
     virtual bool CreatesTakes() = 0;
 
   protected:
+    // False for a parameter the current values of the others make
+    // irrelevant, such as the threshold of a slicer given a slice count
+    virtual bool IsParameterUsed(int algorithmParamEnum) const { return true; }
+
+    double GetParamValue(int algorithmParamEnum) const;
+    int GetParamInt(int algorithmParamEnum) const;
+    bool GetParamBool(int algorithmParamEnum) const;
+
     ReacomaExtension *mApiProvider;
     int mBaseParamIdx = 0;
+    std::shared_ptr<const ParameterSnapshot> mParameters;
 };
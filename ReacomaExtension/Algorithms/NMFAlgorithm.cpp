@@ -1,6 +1,43 @@
 #include "NMFAlgorithm.h"
 #include "IPlugParameter.h"
 #include "ReacomaExtension.h"
+#include "StageCache.h"
+
+namespace {
+
+// Update modes of the NMF client's bases and activations buffers
+enum EFactorMode { kFactorOutput = 0, kFactorSeed, kFactorFixed };
+
+struct NMFFactors {
+    BufferT::type bases;
+    BufferT::type activations;
+    int iterations = 0;
+};
+
+size_t BufferBytes(BufferT::type &buffer) {
+    BufferAdaptor::ReadAccess reader(buffer.get());
+    if (!reader.exists() || !reader.valid())
+        return 0;
+    return reader.numChans() * reader.numFrames() * sizeof(float);
+}
+
+// The client writes refined factors back into the buffers it is seeded
+// from, so every run works on its own copy of the stored factors
+BufferT::type CopyBuffer(BufferT::type &source) {
+    BufferAdaptor::ReadAccess reader(source.get());
+    if (!reader.exists() || !reader.valid())
+        return nullptr;
+
+    auto copy = std::make_shared<MemoryBufferAdaptor>(
+        reader.numChans(), reader.numFrames(), reader.sampleRate());
+    BufferAdaptor::Access writer(copy.get());
+    if (!writer.exists() || !writer.valid())
+        return nullptr;
+    writer.allFrames() <<= reader.allFrames();
+    return BufferT::type(copy);
+}
+
+} // namespace
 
 NMFAlgorithm::NMFAlgorithm(ReacomaExtension *apiProvider)
     : AudioOutputAlgorithm<NRTThreadedNMFClient>(apiProvider) {}
@@ -25,28 +62,67 @@ void NMFAlgorithm::RegisterParameters() {
 
     mApiProvider->GetParam(mBaseParamIdx + NMFAlgorithm::kFFTSize)
         ->InitInt("FFT Size", 1024, 2, 65536);
+
+    mApiProvider->GetParam(mBaseParamIdx + NMFAlgorithm::kOutputLayout)
+        ->InitEnum("Output Layout", NMFAlgorithm::kLayoutTakes,
+                   {"Files", "Multichannel", "Takes"});
 }
 
 bool NMFAlgorithm::DoProcess(InputBufferT::type &sourceBuffer, int numChannels,
                              int frameCount, int sampleRate) {
-    auto componentsParam =
-        mApiProvider->GetParam(mBaseParamIdx + kComponents)->Value();
-    auto iterationsParam =
-        mApiProvider->GetParam(mBaseParamIdx + kIterations)->Value();
-
-    auto windowSize =
-        mApiProvider->GetParam(mBaseParamIdx + NMFAlgorithm::kWindowSize)
-            ->Value();
-    auto hopSize =
-        mApiProvider->GetParam(mBaseParamIdx + NMFAlgorithm::kHopSize)->Value();
-    auto fftSize =
-        mApiProvider->GetParam(mBaseParamIdx + NMFAlgorithm::kFFTSize)->Value();
+    auto componentsParam = GetParamValue(kComponents);
+    auto iterationsParam = GetParamValue(kIterations);
+
+    auto windowSize = GetParamValue(NMFAlgorithm::kWindowSize);
+    auto hopSize = GetParamValue(NMFAlgorithm::kHopSize);
+    auto fftSize = GetParamValue(NMFAlgorithm::kFFTSize);
 
     auto resynthMemoryBuffer = std::make_shared<MemoryBufferAdaptor>(
         numChannels * componentsParam, frameCount, sampleRate);
     auto resynthOutputBuffer =
         fluid::client::BufferT::type(resynthMemoryBuffer);
 
+    Hasher factorsHasher;
+    factorsHasher.AddString("nmf-factors");
+    factorsHasher.AddValue(mSourceKey);
+    factorsHasher.AddValue(componentsParam);
+    factorsHasher.AddValue(windowSize);
+    factorsHasher.AddValue(hopSize);
+    factorsHasher.AddValue(fftSize);
+    mFactorsKey = factorsHasher.Get();
+
+    const int iterations = static_cast<int>(iterationsParam);
+    int iterationsToRun = iterations;
+    LongT::type factorMode = kFactorOutput;
+    BufferT::type basesBuffer = BufferT::type(
+        std::make_shared<MemoryBufferAdaptor>(1, 1, sampleRate));
+    BufferT::type activationsBuffer = BufferT::type(
+        std::make_shared<MemoryBufferAdaptor>(1, 1, sampleRate));
+    mFactorsIterations = iterations;
+    mStoreFactors = true;
+
+    auto previous =
+        mApiProvider->GetStageCache()->Get<NMFFactors>(mFactorsKey);
+    if (previous && previous->iterations <= iterations) {
+        auto seededBases = CopyBuffer(previous->bases);
+        auto seededActivations = CopyBuffer(previous->activations);
+        if (seededBases && seededActivations) {
+            basesBuffer = seededBases;
+            activationsBuffer = seededActivations;
+            factorMode = kFactorSeed;
+            iterationsToRun = iterations - previous->iterations;
+            if (iterationsToRun == 0) {
+                // Already refined this far: with both factors fixed the
+                // client only resynthesises from them, so the output is
+                // that of the stored factors. It needs at least one
+                // iteration, which updates nothing.
+                factorMode = kFactorFixed;
+                iterationsToRun = 1;
+                mStoreFactors = false;
+            }
+        }
+    }
+
     mParams.template set<0>(std::move(sourceBuffer), nullptr);
     mParams.template set<1>(std::move(LongT::type(0)), nullptr);
     mParams.template set<2>(std::move(LongT::type(-1)), nullptr);
@@ -54,12 +130,12 @@ bool NMFAlgorithm::DoProcess(InputBufferT::type &sourceBuffer, int numChannels,
     mParams.template set<4>(std::move(LongT::type(-1)), nullptr);
     mParams.template set<5>(std::move(resynthOutputBuffer), nullptr);
     mParams.template set<6>(std::move(LongT::type(1)), nullptr);
-    mParams.template set<7>(nullptr, nullptr);
-    mParams.template set<8>(std::move(LongT::type(0)), nullptr);
-    mParams.template set<9>(nullptr, nullptr);
-    mParams.template set<10>(std::move(LongT::type(0)), nullptr);
+    mParams.template set<7>(std::move(basesBuffer), nullptr);
+    mParams.template set<8>(std::move(LongT::type(factorMode)), nullptr);
+    mParams.template set<9>(std::move(activationsBuffer), nullptr);
+    mParams.template set<10>(std::move(LongT::type(factorMode)), nullptr);
     mParams.template set<11>(std::move(componentsParam), nullptr);
-    mParams.template set<12>(std::move(iterationsParam), nullptr);
+    mParams.template set<12>(std::move(LongT::type(iterationsToRun)), nullptr);
     mParams.template set<13>(
         std::move(fluid::client::FFTParams(windowSize, hopSize, fftSize,
                                            std::max(windowSize, fftSize))),
@@ -77,10 +153,76 @@ bool NMFAlgorithm::HandleResults(MediaItem *item, MediaItem_Take *take,
                                  int numChannels, int sampleRate) {
     auto resynthOutputBuffer =
         mParams.template get<5>(); // Get the buffer we created in DoProcess
-    AddOutputToTake(item, resynthOutputBuffer, sampleRate, "nmf");
+    AddComponentOutputs(item, resynthOutputBuffer, numChannels, sampleRate);
+
+    if (mStoreFactors) {
+        auto factors = std::make_shared<NMFFactors>();
+        factors->bases = mParams.template get<7>();
+        factors->activations = mParams.template get<9>();
+        factors->iterations = mFactorsIterations;
+
+        const size_t bytes =
+            BufferBytes(factors->bases) + BufferBytes(factors->activations);
+        if (bytes > 0)
+            mApiProvider->GetStageCache()->Put(mFactorsKey, factors, bytes);
+    }
     return true;
 }
 
+void NMFAlgorithm::AddComponentOutputs(MediaItem *item,
+                                       BufferT::type &resynth,
+                                       int numChannels, int sampleRate) {
+    int numComponents = 0;
+    {
+        BufferAdaptor::ReadAccess reader(resynth.get());
+        if (!reader.exists() || !reader.valid() || numChannels <= 0)
+            return;
+        numComponents = static_cast<int>(reader.numChans()) / numChannels;
+    }
+
+    // The client writes component c of source channel ch to channel
+    // ch * numComponents + c; outputs are laid out component by component
+    auto componentChannels = [&](int component) {
+        std::vector<int> channels;
+        for (int ch = 0; ch < numChannels; ch++)
+            channels.push_back(ch * numComponents + component);
+        return channels;
+    };
+
+    int layout = GetParamInt(kOutputLayout);
+    // Take channel modes only select single channels and stereo pairs
+    if (layout == kLayoutTakes && numChannels > 2)
+        layout = kLayoutFiles;
+
+    if (layout == kLayoutFiles) {
+        for (int c = 0; c < numComponents; c++)
+            AddOutputToTakes(item, resynth, sampleRate,
+                             "nmf-" + std::to_string(c + 1),
+                             componentChannels(c), {OutputTake{}});
+        return;
+    }
+
+    std::vector<int> channelMap;
+    for (int c = 0; c < numComponents; c++) {
+        const auto channels = componentChannels(c);
+        channelMap.insert(channelMap.end(), channels.begin(), channels.end());
+    }
+
+    std::vector<OutputTake> takes;
+    if (layout == kLayoutMultichannel) {
+        takes.push_back({});
+    } else {
+        for (int c = 0; c < numComponents; c++) {
+            // I_CHANMODE 3 + n plays channel n alone, 67 + n the pair n, n+1
+            const int firstChannel = c * numChannels;
+            takes.push_back({"-" + std::to_string(c + 1),
+                             numChannels == 1 ? 3 + firstChannel
+                                              : 67 + firstChannel});
+        }
+    }
+    AddOutputToTakes(item, resynth, sampleRate, "nmf", channelMap, takes);
+}
+
 const char *NMFAlgorithm::GetName() const {
     return "Non-negative Matrix Factorisation";
 }
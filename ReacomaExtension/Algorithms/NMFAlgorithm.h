@@ -11,9 +11,20 @@ class NMFAlgorithm
         kWindowSize,
         kHopSize,
         kFFTSize,
+        kOutputLayout,
         kNumParams
     };
 
+    enum EOutputLayout {
+        // One file per component
+        kLayoutFiles = 0,
+        // Every component in one file, component after component
+        kLayoutMultichannel,
+        // As kLayoutMultichannel, with one take per component reading its
+        // channels of the shared file
+        kLayoutTakes
+    };
+
     NMFAlgorithm(ReacomaExtension *apiProvider);
     ~NMFAlgorithm() override;
 
@@ -26,4 +37,15 @@ class NMFAlgorithm
                    int frameCount, int sampleRate) override;
     bool HandleResults(MediaItem *item, MediaItem_Take *take, int numChannels,
                        int sampleRate) override;
+
+  private:
+    void AddComponentOutputs(MediaItem *item, BufferT::type &resynth,
+                             int numChannels, int sampleRate);
+
+    // Factorisations are kept per item so a later run with the same
+    // components and FFT settings continues from them instead of restarting
+    // from a random initialisation
+    uint64_t mFactorsKey = 0;
+    int mFactorsIterations = 0;
+    bool mStoreFactors = false;
 };
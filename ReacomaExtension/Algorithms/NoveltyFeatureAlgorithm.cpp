@@ -1,4 +1,5 @@
 #include "NoveltyFeatureAlgorithm.h"
+#include "CurveEnvelope.h"
 #include "IPlugParameter.h"
 #include "ReacomaExtension.h"
 
@@ -43,30 +44,12 @@ void NoveltyFeatureAlgorithm::RegisterParameters() {
 bool NoveltyFeatureAlgorithm::DoProcess(InputBufferT::type &sourceBuffer,
                                         int numChannels, int frameCount,
                                         int sampleRate) {
-    auto kernelsize =
-        mApiProvider
-            ->GetParam(mBaseParamIdx + NoveltyFeatureAlgorithm::kKernelSize)
-            ->Value();
-    auto filtersize =
-        mApiProvider
-            ->GetParam(mBaseParamIdx + NoveltyFeatureAlgorithm::kFilterSize)
-            ->Value();
-    auto windowSize =
-        mApiProvider
-            ->GetParam(mBaseParamIdx + NoveltyFeatureAlgorithm::kWindowSize)
-            ->Value();
-    auto hopSize =
-        mApiProvider
-            ->GetParam(mBaseParamIdx + NoveltyFeatureAlgorithm::kHopSize)
-            ->Value();
-    auto fftSize =
-        mApiProvider
-            ->GetParam(mBaseParamIdx + NoveltyFeatureAlgorithm::kFFTSize)
-            ->Value();
-    auto algorithm =
-        mApiProvider
-            ->GetParam(mBaseParamIdx + NoveltyFeatureAlgorithm::kAlgorithm)
-            ->Value();
+    auto kernelsize = GetParamValue(NoveltyFeatureAlgorithm::kKernelSize);
+    auto filtersize = GetParamValue(NoveltyFeatureAlgorithm::kFilterSize);
+    auto windowSize = GetParamValue(NoveltyFeatureAlgorithm::kWindowSize);
+    auto hopSize = GetParamValue(NoveltyFeatureAlgorithm::kHopSize);
+    auto fftSize = GetParamValue(NoveltyFeatureAlgorithm::kFFTSize);
+    auto algorithm = GetParamValue(NoveltyFeatureAlgorithm::kAlgorithm);
 
     int estimatedSamples =
         std::max(1, static_cast<int>(frameCount / hopSize)) + 2;
@@ -104,32 +87,40 @@ bool NoveltyFeatureAlgorithm::DoProcess(InputBufferT::type &sourceBuffer,
 bool NoveltyFeatureAlgorithm::HandleResults(MediaItem *item,
                                             MediaItem_Take *take,
                                             int numChannels, int sampleRate) {
-    auto processedSlicesBuffer = mParams.template get<5>();
-    BufferAdaptor::ReadAccess reader(processedSlicesBuffer.get());
+    auto featureBuffer = mParams.template get<5>();
+    BufferAdaptor::ReadAccess reader(featureBuffer.get());
 
     if (!reader.exists() || !reader.valid()) {
         return false;
     }
 
-    // int markerCount = GetNumTakeMarkers(take);
-    // for (int i = markerCount - 1; i >= 0; i--) {
-    //     DeleteTakeMarker(take, i);
-    // }
-
-    // double itemLength = GetMediaItemInfo_Value(item, "D_LENGTH");
-    // auto view = reader.samps(0);
-    // for (fluid::index i = 0; i < view.size(); i++) {
-    //     if (view(i) > 0) {
-    //         double markerTimeInSeconds =
-    //             static_cast<double>(view(i)) / sampleRate;
-    //         if (markerTimeInSeconds < itemLength) {
-    //             SetTakeMarker(take, -1, "", &markerTimeInSeconds, nullptr);
-    //         }
-    //     }
-    // }
+    auto view = reader.samps(0);
+    mCurve.assign(view.begin(), view.end());
+    mCurveHopSize = GetParamInt(NoveltyFeatureAlgorithm::kHopSize);
+
+    return ApplyCurveEnvelope(item, take, mCurve,
+                              static_cast<double>(mCurveHopSize) / sampleRate);
+}
+
+bool NoveltyFeatureAlgorithm::StoreResults(AnalysisResult &result) {
+    if (mCurve.empty())
+        return false;
+    result.curve = mCurve;
+    result.curveHopSize = mCurveHopSize;
     return true;
 }
 
+bool NoveltyFeatureAlgorithm::RestoreResults(MediaItem *item,
+                                             MediaItem_Take *take,
+                                             int numChannels, int sampleRate,
+                                             const AnalysisResult &result) {
+    if (result.curve.empty() || result.curveHopSize <= 0)
+        return false;
+    return ApplyCurveEnvelope(
+        item, take, result.curve,
+        static_cast<double>(result.curveHopSize) / sampleRate);
+}
+
 const char *NoveltyFeatureAlgorithm::GetName() const {
     return "Novelty Feature";
 }
@@ -31,9 +31,21 @@ class NoveltyFeatureAlgorithm
     void RegisterParameters() override;
     int GetNumAlgorithmParams() const override;
 
+    bool SupportsSegmentation() override { return false; }
+    bool SupportsRegions() override { return false; }
+    bool WritesCurve() override { return true; }
+
   protected:
     bool DoProcess(InputBufferT::type &sourceBuffer, int numChannels,
                    int frameCount, int sampleRate) override;
     bool HandleResults(MediaItem *item, MediaItem_Take *take, int numChannels,
                        int sampleRate) override;
+    bool StoreResults(AnalysisResult &result) override;
+    bool RestoreResults(MediaItem *item, MediaItem_Take *take, int numChannels,
+                        int sampleRate, const AnalysisResult &result) override;
+
+  private:
+    // Of the last run, one value every mCurveHopSize samples
+    std::vector<float> mCurve;
+    int mCurveHopSize = 0;
 };
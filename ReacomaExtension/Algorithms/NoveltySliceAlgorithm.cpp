@@ -45,53 +45,132 @@ void NoveltySliceAlgorithm::RegisterParameters() {
     algoParam->SetDisplayText(NoveltySliceAlgorithm::kChroma, "Chroma");
     algoParam->SetDisplayText(NoveltySliceAlgorithm::kPitch, "Pitch");
     algoParam->SetDisplayText(NoveltySliceAlgorithm::kLoudness, "Loudness");
+
+    // 0 slices at the threshold; otherwise the threshold is searched for
+    mApiProvider
+        ->GetParam(mBaseParamIdx + NoveltySliceAlgorithm::kTargetSlices)
+        ->InitInt("Target Slices", 0, 0, 4096);
 }
 
 bool NoveltySliceAlgorithm::DoProcess(InputBufferT::type &sourceBuffer,
                                       int numChannels, int frameCount,
                                       int sampleRate) {
-    int estimatedSlices = std::max(1, static_cast<int>(frameCount / 1024.0));
-    auto outBuffer =
-        std::make_shared<MemoryBufferAdaptor>(1, estimatedSlices, sampleRate);
-    auto slicesOutputBuffer = fluid::client::BufferT::type(outBuffer);
+    auto threshold = GetParamValue(NoveltySliceAlgorithm::kThreshold);
 
-    auto threshold =
-        mApiProvider
-            ->GetParam(mBaseParamIdx + NoveltySliceAlgorithm::kThreshold)
-            ->Value();
-
-    auto kernelsize =
-        mApiProvider
-            ->GetParam(mBaseParamIdx + NoveltySliceAlgorithm::kKernelSize)
-            ->Value();
-    auto filtersize =
-        mApiProvider
-            ->GetParam(mBaseParamIdx + NoveltySliceAlgorithm::kFilterSize)
-            ->Value();
-    auto minslicelength =
-        mApiProvider
-            ->GetParam(mBaseParamIdx + NoveltySliceAlgorithm::kMinSliceLength)
-            ->Value();
-    auto windowSize =
-        mApiProvider
-            ->GetParam(mBaseParamIdx + NoveltySliceAlgorithm::kWindowSize)
-            ->Value();
-    auto hopSize =
-        mApiProvider->GetParam(mBaseParamIdx + NoveltySliceAlgorithm::kHopSize)
-            ->Value();
-    auto fftSize =
-        mApiProvider->GetParam(mBaseParamIdx + NoveltySliceAlgorithm::kFFTSize)
-            ->Value();
-    auto algorithm =
-        mApiProvider
-            ->GetParam(mBaseParamIdx + NoveltySliceAlgorithm::kAlgorithm)
-            ->Value();
+    auto kernelsize = GetParamValue(NoveltySliceAlgorithm::kKernelSize);
+    auto filtersize = GetParamValue(NoveltySliceAlgorithm::kFilterSize);
+    auto minslicelength = GetParamValue(NoveltySliceAlgorithm::kMinSliceLength);
+    auto windowSize = GetParamValue(NoveltySliceAlgorithm::kWindowSize);
+    auto hopSize = GetParamValue(NoveltySliceAlgorithm::kHopSize);
+    auto fftSize = GetParamValue(NoveltySliceAlgorithm::kFFTSize);
+    auto algorithm = GetParamValue(NoveltySliceAlgorithm::kAlgorithm);
 
     if (static_cast<int>(kernelsize) % 2 == 0)
         kernelsize += 1;
     if (static_cast<int>(filtersize) % 2 == 0)
         filtersize += 1;
 
+    const int targetSlices = GetParamInt(NoveltySliceAlgorithm::kTargetSlices);
+    if (targetSlices > 0) {
+        // The novelty curve doesn't depend on the threshold or the minimum
+        // slice length
+        Hasher hasher;
+        hasher.AddString("novelty-curve");
+        hasher.AddValue(mSourceKey);
+        hasher.AddValue(algorithm);
+        hasher.AddValue(kernelsize);
+        hasher.AddValue(filtersize);
+        hasher.AddValue(windowSize);
+        hasher.AddValue(hopSize);
+        hasher.AddValue(fftSize);
+
+        // Both clients read the mixdown on the worker
+        auto mixdown = std::make_shared<std::vector<float>>(
+            MixDown(sourceBuffer, numChannels, frameCount));
+
+        auto computeCurve = [this, mixdown, frameCount, sampleRate, algorithm,
+                             kernelsize, filtersize, windowSize, hopSize,
+                             fftSize](std::vector<float> &curve) {
+            using FeatureClient = NRTThreadedNoveltyFeatureClient;
+            FluidContext context;
+            FeatureClient::ParamSetType params{
+                FeatureClient::getParameterDescriptors(),
+                FluidDefaultAllocator()};
+            auto features =
+                std::make_shared<MemoryBufferAdaptor>(1, 1, sampleRate);
+
+            params.template set<0>(
+                InputBufferT::type(new fluid::VectorBufferAdaptor(
+                    *mixdown, 1, frameCount, sampleRate)),
+                nullptr);
+            params.template set<1>(LongT::type(0), nullptr);
+            params.template set<2>(LongT::type(-1), nullptr);
+            params.template set<3>(LongT::type(0), nullptr);
+            params.template set<4>(LongT::type(-1), nullptr);
+            params.template set<5>(BufferT::type(features), nullptr);
+            params.template set<6>(LongT::type(algorithm), nullptr);
+            params.template set<7>(
+                LongRuntimeMaxParam(kernelsize, kernelsize), nullptr);
+            params.template set<8>(
+                LongRuntimeMaxParam(filtersize, filtersize), nullptr);
+            params.template set<10>(
+                fluid::client::FFTParams(windowSize, hopSize, fftSize,
+                                         std::max(windowSize, fftSize)),
+                nullptr);
+
+            FeatureClient client(params, context);
+            if (!RunClient(client, params, 0.0, kCurveProgress))
+                return false;
+            return ReadCurve(params.template get<5>(), curve);
+        };
+
+        auto slice = [this, mixdown, frameCount, sampleRate, algorithm,
+                      kernelsize, filtersize, minslicelength, windowSize,
+                      hopSize, fftSize](double sliceThreshold,
+                                        BufferT::type slices) {
+            using SliceClient = NRTThreadingNoveltySliceClient;
+            FluidContext context;
+            SliceClient::ParamSetType params{
+                SliceClient::getParameterDescriptors(),
+                FluidDefaultAllocator()};
+
+            params.template set<0>(
+                InputBufferT::type(new fluid::VectorBufferAdaptor(
+                    *mixdown, 1, frameCount, sampleRate)),
+                nullptr);
+            params.template set<1>(LongT::type(0), nullptr);
+            params.template set<2>(LongT::type(-1), nullptr);
+            params.template set<3>(LongT::type(0), nullptr);
+            params.template set<4>(LongT::type(-1), nullptr);
+            params.template set<5>(std::move(slices), nullptr);
+            params.template set<6>(LongT::type(algorithm), nullptr);
+            params.template set<7>(
+                LongRuntimeMaxParam(kernelsize, kernelsize), nullptr);
+            params.template set<8>(FloatT::type(sliceThreshold), nullptr);
+            params.template set<9>(
+                LongRuntimeMaxParam(filtersize, filtersize), nullptr);
+            params.template set<10>(LongT::type(minslicelength), nullptr);
+            params.template set<11>(
+                fluid::client::FFTParams(windowSize, hopSize, fftSize,
+                                         std::max(windowSize, fftSize)),
+                nullptr);
+
+            SliceClient client(params, context);
+            return RunClient(client, params, kCurveProgress, 1.0);
+        };
+
+        return StartThresholdSearch(hasher.Get(), std::move(computeCurve),
+                                    std::move(slice), SliceRule::kPeak,
+                                    targetSlices,
+                                    static_cast<int>(minslicelength),
+                                    sampleRate);
+    }
+
+    int estimatedSlices = std::max(1, static_cast<int>(frameCount / 1024.0));
+    auto outBuffer =
+        std::make_shared<MemoryBufferAdaptor>(1, estimatedSlices, sampleRate);
+    auto slicesOutputBuffer = fluid::client::BufferT::type(outBuffer);
+
     mParams.template set<0>(std::move(sourceBuffer), nullptr);
     mParams.template set<1>(std::move(LongT::type(0)), nullptr);
     mParams.template set<2>(std::move(LongT::type(-1)), nullptr);
@@ -124,4 +203,9 @@ int NoveltySliceAlgorithm::GetNumAlgorithmParams() const { return kNumParams; }
 
 BufferT::type &NoveltySliceAlgorithm::GetSlicesBuffer() {
     return mParams.template get<5>();
-}
\ No newline at end of file
+}
+
+bool NoveltySliceAlgorithm::IsParameterUsed(int algorithmParamEnum) const {
+    // A slice count is reached by searching for the threshold
+    return algorithmParamEnum != kThreshold || GetParamInt(kTargetSlices) <= 0;
+}
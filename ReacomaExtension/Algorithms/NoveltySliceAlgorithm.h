@@ -1,4 +1,5 @@
 #pragma once
+#include "../../dependencies/flucoma-core/include/flucoma/clients/rt/NoveltyFeatureClient.hpp"
 #include "../../dependencies/flucoma-core/include/flucoma/clients/rt/NoveltySliceClient.hpp"
 #include "SlicingAlgorithm.h"
 
@@ -14,6 +15,7 @@ public:
         kHopSize,
         kFFTSize,
         kAlgorithm,
+        kTargetSlices,
         kNumParams
     };
 
@@ -35,6 +37,7 @@ public:
 
 protected:
     BufferT::type &GetSlicesBuffer() override;
+    bool IsParameterUsed(int algorithmParamEnum) const override;
     bool DoProcess(InputBufferT::type &sourceBuffer, int numChannels,
                    int frameCount, int sampleRate) override;
 };
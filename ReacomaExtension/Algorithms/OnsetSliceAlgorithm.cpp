@@ -3,7 +3,7 @@
 #include "ReacomaExtension.h"
 
 OnsetSliceAlgorithm::OnsetSliceAlgorithm(ReacomaExtension *apiProvider)
-    : FlucomaAlgorithm<NRTThreadingOnsetSliceClient>(apiProvider) {}
+    : SlicingAlgorithm<NRTThreadingOnsetSliceClient>(apiProvider) {}
 
 OnsetSliceAlgorithm::~OnsetSliceAlgorithm() = default;
 
@@ -27,33 +27,123 @@ void OnsetSliceAlgorithm::RegisterParameters() {
         ->InitInt("Hop Size", 512, 2, 65536);
     mApiProvider->GetParam(mBaseParamIdx + kFFTSize)
         ->InitInt("FFT Size", 1024, 2, 65536);
+    // 0 slices at the threshold; otherwise the threshold is searched for
+    mApiProvider->GetParam(mBaseParamIdx + kTargetSlices)
+        ->InitInt("Target Slices", 0, 0, 4096);
 }
 
 bool OnsetSliceAlgorithm::DoProcess(InputBufferT::type &sourceBuffer,
                                     int numChannels, int frameCount,
                                     int sampleRate) {
+    auto metric = GetParamValue(kMetric);
+    auto threshold = GetParamValue(kThreshold);
+    auto filterSize = GetParamValue(kFilterSize);
+    auto frameDelta = GetParamValue(kFrameDelta);
+    auto minLength = GetParamValue(kMinSliceLength);
+    auto windowSize = GetParamValue(kWindowSize);
+    auto hopSize = GetParamValue(kHopSize);
+    auto fftSize = GetParamValue(kFFTSize);
+
+    if (static_cast<int>(filterSize) % 2 == 0)
+        filterSize += 1;
+
+    const int targetSlices = GetParamInt(kTargetSlices);
+    if (targetSlices > 0) {
+        // The onset curve doesn't depend on the threshold or the minimum
+        // slice length
+        Hasher hasher;
+        hasher.AddString("onset-curve");
+        hasher.AddValue(mSourceKey);
+        hasher.AddValue(metric);
+        hasher.AddValue(filterSize);
+        hasher.AddValue(frameDelta);
+        hasher.AddValue(windowSize);
+        hasher.AddValue(hopSize);
+        hasher.AddValue(fftSize);
+
+        // Both clients read the mixdown on the worker
+        auto mixdown = std::make_shared<std::vector<float>>(
+            MixDown(sourceBuffer, numChannels, frameCount));
+
+        auto computeCurve = [this, mixdown, frameCount, sampleRate, metric,
+                             filterSize, frameDelta, windowSize, hopSize,
+                             fftSize](std::vector<float> &curve) {
+            using FeatureClient = NRTThreadedOnsetFeatureClient;
+            FluidContext context;
+            FeatureClient::ParamSetType params{
+                FeatureClient::getParameterDescriptors(),
+                FluidDefaultAllocator()};
+            auto features =
+                std::make_shared<MemoryBufferAdaptor>(1, 1, sampleRate);
+
+            params.template set<0>(
+                InputBufferT::type(new fluid::VectorBufferAdaptor(
+                    *mixdown, 1, frameCount, sampleRate)),
+                nullptr);
+            params.template set<1>(LongT::type(0), nullptr);
+            params.template set<2>(LongT::type(-1), nullptr);
+            params.template set<3>(LongT::type(0), nullptr);
+            params.template set<4>(LongT::type(-1), nullptr);
+            params.template set<5>(BufferT::type(features), nullptr);
+            params.template set<6>(LongT::type(metric), nullptr);
+            params.template set<7>(
+                LongRuntimeMaxParam(filterSize, filterSize), nullptr);
+            params.template set<8>(LongT::type(frameDelta), nullptr);
+            params.template set<9>(
+                fluid::client::FFTParams(windowSize, hopSize, fftSize,
+                                         std::max(windowSize, fftSize)),
+                nullptr);
+
+            FeatureClient client(params, context);
+            if (!RunClient(client, params, 0.0, kCurveProgress))
+                return false;
+            return ReadCurve(params.template get<5>(), curve);
+        };
+
+        auto slice = [this, mixdown, frameCount, sampleRate, metric,
+                      minLength, filterSize, frameDelta, windowSize, hopSize,
+                      fftSize](double sliceThreshold, BufferT::type slices) {
+            using SliceClient = NRTThreadingOnsetSliceClient;
+            FluidContext context;
+            SliceClient::ParamSetType params{
+                SliceClient::getParameterDescriptors(),
+                FluidDefaultAllocator()};
+
+            params.template set<0>(
+                InputBufferT::type(new fluid::VectorBufferAdaptor(
+                    *mixdown, 1, frameCount, sampleRate)),
+                nullptr);
+            params.template set<1>(LongT::type(0), nullptr);
+            params.template set<2>(LongT::type(-1), nullptr);
+            params.template set<3>(LongT::type(0), nullptr);
+            params.template set<4>(LongT::type(-1), nullptr);
+            params.template set<5>(std::move(slices), nullptr);
+            params.template set<6>(LongT::type(metric), nullptr);
+            params.template set<7>(FloatT::type(sliceThreshold), nullptr);
+            params.template set<8>(LongT::type(minLength), nullptr);
+            params.template set<9>(
+                LongRuntimeMaxParam(filterSize, filterSize), nullptr);
+            params.template set<10>(LongT::type(frameDelta), nullptr);
+            params.template set<11>(
+                fluid::client::FFTParams(windowSize, hopSize, fftSize,
+                                         std::max(windowSize, fftSize)),
+                nullptr);
+
+            SliceClient client(params, context);
+            return RunClient(client, params, kCurveProgress, 1.0);
+        };
+
+        return StartThresholdSearch(hasher.Get(), std::move(computeCurve),
+                                    std::move(slice), SliceRule::kRisingEdge,
+                                    targetSlices, static_cast<int>(minLength),
+                                    sampleRate);
+    }
+
     int estimatedSlices = std::max(1, static_cast<int>(frameCount / 1024.0));
     auto outBuffer =
         std::make_shared<MemoryBufferAdaptor>(1, estimatedSlices, sampleRate);
     auto slicesOutputBuffer = fluid::client::BufferT::type(outBuffer);
 
-    auto metric = mApiProvider->GetParam(mBaseParamIdx + kMetric)->Value();
-    auto threshold =
-        mApiProvider->GetParam(mBaseParamIdx + kThreshold)->Value();
-    auto filterSize =
-        mApiProvider->GetParam(mBaseParamIdx + kFilterSize)->Value();
-    auto frameDelta =
-        mApiProvider->GetParam(mBaseParamIdx + kFrameDelta)->Value();
-    auto minLength =
-        mApiProvider->GetParam(mBaseParamIdx + kMinSliceLength)->Value();
-    auto windowSize =
-        mApiProvider->GetParam(mBaseParamIdx + kWindowSize)->Value();
-    auto hopSize = mApiProvider->GetParam(mBaseParamIdx + kHopSize)->Value();
-    auto fftSize = mApiProvider->GetParam(mBaseParamIdx + kFFTSize)->Value();
-
-    if (static_cast<int>(filterSize) % 2 == 0)
-        filterSize += 1;
-
     mParams.template set<0>(std::move(sourceBuffer), nullptr);
     mParams.template set<1>(std::move(LongT::type(0)), nullptr);
     mParams.template set<2>(std::move(LongT::type(-1)), nullptr);
@@ -78,33 +168,15 @@ bool OnsetSliceAlgorithm::DoProcess(InputBufferT::type &sourceBuffer,
     return result.ok();
 }
 
-bool OnsetSliceAlgorithm::HandleResults(MediaItem *item, MediaItem_Take *take,
-                                        int numChannels, int sampleRate) {
-    auto processedSlicesBuffer = mParams.template get<5>();
-    BufferAdaptor::ReadAccess reader(processedSlicesBuffer.get());
-
-    if (!reader.exists() || !reader.valid())
-        return false;
+const char *OnsetSliceAlgorithm::GetName() const { return "Onset Slice"; }
 
-    int markerCount = GetNumTakeMarkers(take);
-    for (int i = markerCount - 1; i >= 0; i--) {
-        DeleteTakeMarker(take, i);
-    }
+int OnsetSliceAlgorithm::GetNumAlgorithmParams() const { return kNumParams; }
 
-    double itemLength = GetMediaItemInfo_Value(item, "D_LENGTH");
-    auto view = reader.samps(0);
-    for (fluid::index i = 0; i < view.size(); i++) {
-        if (view(i) > 0) {
-            double markerTimeInSeconds =
-                static_cast<double>(view(i)) / sampleRate;
-            if (markerTimeInSeconds < itemLength) {
-                SetTakeMarker(take, -1, "", &markerTimeInSeconds, nullptr);
-            }
-        }
-    }
-    return true;
+BufferT::type &OnsetSliceAlgorithm::GetSlicesBuffer() {
+    return mParams.template get<5>();
 }
 
-const char *OnsetSliceAlgorithm::GetName() const { return "Onset Slice"; }
-
-int OnsetSliceAlgorithm::GetNumAlgorithmParams() const { return kNumParams; }
+bool OnsetSliceAlgorithm::IsParameterUsed(int algorithmParamEnum) const {
+    // A slice count is reached by searching for the threshold
+    return algorithmParamEnum != kThreshold || GetParamInt(kTargetSlices) <= 0;
+}
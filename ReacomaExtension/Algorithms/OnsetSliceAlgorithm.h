@@ -1,9 +1,10 @@
 #pragma once
+#include "../../dependencies/flucoma-core/include/flucoma/clients/rt/OnsetFeatureClient.hpp"
 #include "../../dependencies/flucoma-core/include/flucoma/clients/rt/OnsetSliceClient.hpp"
-#include "FlucomaAlgorithmBase.h"
+#include "SlicingAlgorithm.h"
 
 class OnsetSliceAlgorithm
-    : public FlucomaAlgorithm<fluid::client::NRTThreadingOnsetSliceClient> {
+    : public SlicingAlgorithm<fluid::client::NRTThreadingOnsetSliceClient> {
   public:
     enum Params {
         kMetric = 0,
@@ -14,6 +15,7 @@ class OnsetSliceAlgorithm
         kWindowSize,
         kHopSize,
         kFFTSize,
+        kTargetSlices,
         kNumParams
     };
 
@@ -25,8 +27,8 @@ class OnsetSliceAlgorithm
     int GetNumAlgorithmParams() const override;
 
   protected:
+    BufferT::type &GetSlicesBuffer() override;
+    bool IsParameterUsed(int algorithmParamEnum) const override;
     bool DoProcess(InputBufferT::type &sourceBuffer, int numChannels,
                    int frameCount, int sampleRate) override;
-    bool HandleResults(MediaItem *item, MediaItem_Take *take, int numChannels,
-                       int sampleRate) override;
 };
\ No newline at end of file
@@ -0,0 +1,27 @@
+#include "ParameterSnapshot.h"
+#include "Hasher.h"
+#include "IAlgorithm.h"
+#include "ReacomaExtension.h"
+
+ParameterSnapshot::ParameterSnapshot(std::vector<double> values)
+    : mValues(std::move(values)) {
+    Hasher hasher;
+    hasher.AddValue(GetNumParams());
+    for (double value : mValues)
+        hasher.AddValue(value);
+    mHash = hasher.Get();
+}
+
+ParameterSnapshot ParameterSnapshot::Capture(ReacomaExtension *provider,
+                                             const IAlgorithm &algorithm) {
+    std::vector<double> values(algorithm.GetNumAlgorithmParams());
+    for (int i = 0; i < static_cast<int>(values.size()); ++i)
+        values[i] = provider->GetParam(algorithm.GetGlobalParamIdx(i))->Value();
+    return ParameterSnapshot(std::move(values));
+}
+
+double ParameterSnapshot::Get(int param) const {
+    if (param < 0 || param >= GetNumParams())
+        return 0.0;
+    return mValues[param];
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+class IAlgorithm;
+class ReacomaExtension;
+
+// The values of an algorithm's parameters at one point in time. A batch
+// captures one when it starts and every job reads from it instead of the
+// live parameters, so changing a parameter mid-batch can't mix settings
+// within a run. The hash identifies the settings a result was made with.
+class ParameterSnapshot {
+  public:
+    ParameterSnapshot() = default;
+    explicit ParameterSnapshot(std::vector<double> values);
+
+    static ParameterSnapshot Capture(ReacomaExtension *provider,
+                                     const IAlgorithm &algorithm);
+
+    // By algorithm parameter enum, with the conversions of IParam
+    double Get(int param) const;
+    int GetInt(int param) const { return static_cast<int>(Get(param)); }
+    bool GetBool(int param) const { return Get(param) >= 0.5; }
+
+    int GetNumParams() const { return static_cast<int>(mValues.size()); }
+    const std::vector<double> &GetValues() const { return mValues; }
+    uint64_t GetHash() const { return mHash; }
+
+  private:
+    std::vector<double> mValues;
+    uint64_t mHash = 0;
+};
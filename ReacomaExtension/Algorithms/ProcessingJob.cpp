@@ -1,9 +1,12 @@
 #include "ProcessingJob.h"
 #include "NoveltySliceAlgorithm.h"
+#include "NoveltyFeatureAlgorithm.h"
 #include "HPSSAlgorithm.h"
 #include "NMFAlgorithm.h"
 #include "OnsetSliceAlgorithm.h"
+#include "ItemOverrides.h"
 #include "ReacomaExtension.h"
+#include "SinesAlgorithm.h"
 #include "TransientSliceAlgorithm.h"
 #include "TransientAlgorithm.h"
 #include "AmpSliceAlgorithm.h"
@@ -23,10 +26,11 @@ bool ProcessingJob::IsFinished() {
     return mAlgorithm ? mAlgorithm->IsFinished() : true;
 }
 
-void ProcessingJob::Finalize() {
+bool ProcessingJob::Finalize() {
     if (mAlgorithm && mItem) {
-        mAlgorithm->FinalizeProcess(mItem);
+        return mAlgorithm->FinalizeProcess(mItem);
     }
+    return false;
 }
 
 void ProcessingJob::Cancel() {
@@ -37,7 +41,8 @@ void ProcessingJob::Cancel() {
 
 std::unique_ptr<ProcessingJob>
 ProcessingJob::Create(ReacomaExtension::EAlgorithmChoice algoChoice,
-                      MediaItem *item, ReacomaExtension *provider) {
+                      MediaItem *item, ReacomaExtension *provider,
+                      std::shared_ptr<const ParameterSnapshot> parameters) {
     std::unique_ptr<IAlgorithm> algorithm = nullptr;
     const IAlgorithm *prototypeAlgorithm = nullptr;
 
@@ -74,10 +79,33 @@ ProcessingJob::Create(ReacomaExtension::EAlgorithmChoice algoChoice,
             algorithm = std::make_unique<AmpSliceAlgorithm>(provider);
             prototypeAlgorithm = provider->GetAmpSliceAlgorithm();
             break;
+        case ReacomaExtension::kNoveltyFeature:
+            algorithm = std::make_unique<NoveltyFeatureAlgorithm>(provider);
+            prototypeAlgorithm = provider->GetNoveltyFeatureAlgorithm();
+            break;
+        case ReacomaExtension::kSines:
+            algorithm = std::make_unique<SinesAlgorithm>(provider);
+            prototypeAlgorithm = provider->GetSinesAlgorithm();
+            break;
     }
 
     if (algorithm && prototypeAlgorithm) {
         algorithm->SetBaseParamIdx(prototypeAlgorithm->GetBaseParamIdx());
+        // Without a snapshot from the batch, the job still reads fixed
+        // values: those of the moment it was created
+        if (!parameters)
+            parameters = std::make_shared<const ParameterSnapshot>(
+                ParameterSnapshot::Capture(provider, *prototypeAlgorithm));
+
+        // Values stored on the item take the place of the batch's
+        std::vector<double> values = parameters->GetValues();
+        if (ApplyItemOverrides(provider->GetInputTake(item),
+                               provider->GetAlgorithmKey(algoChoice),
+                               provider->GetParamNames(*prototypeAlgorithm),
+                               values))
+            parameters =
+                std::make_shared<const ParameterSnapshot>(std::move(values));
+        algorithm->SetParameters(std::move(parameters));
         return std::make_unique<ProcessingJob>(std::move(algorithm), item);
     }
     return nullptr;
@@ -18,11 +18,12 @@ class ProcessingJob {
 public:
     static std::unique_ptr<ProcessingJob>
     Create(ReacomaExtension::EAlgorithmChoice algoChoice, MediaItem *item,
-           ReacomaExtension *provider);
+           ReacomaExtension *provider,
+           std::shared_ptr<const ParameterSnapshot> parameters);
 
     void Start();
     bool IsFinished();
-    void Finalize();
+    bool Finalize();
     void Cancel();
 
     double GetProgress() { return mAlgorithm->GetProgress(); }
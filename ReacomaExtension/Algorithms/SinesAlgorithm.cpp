@@ -0,0 +1,303 @@
+#include "SinesAlgorithm.h"
+#include "IPlugParameter.h"
+#include "ReacomaExtension.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace {
+
+using SinesClient = fluid::client::NRTThreadedSinesClient;
+
+struct SinesSettings {
+    int bandwidth;
+    double detectionThreshold;
+    double birthLowThreshold;
+    double birthHighThreshold;
+    int minTrackLength;
+    int trackingMethod;
+    double trackMagRange;
+    double trackFreqRange;
+    double trackProb;
+    int windowSize;
+    int hopSize;
+    int fftSize;
+};
+
+// A client separating one channel, with the audio and buffers it reads and
+// writes. The client refers to the parameters and context, so channels are
+// kept behind pointers that stay put, shared so that the worker can be
+// copied into a std::function.
+struct ChannelSeparation {
+    ChannelSeparation(std::vector<float> channelAudio, int frameCount,
+                      int sampleRate, const SinesSettings &settings)
+        : audio(std::move(channelAudio)),
+          params{SinesClient::getParameterDescriptors(),
+                 FluidDefaultAllocator()},
+          sines(std::make_shared<MemoryBufferAdaptor>(1, frameCount,
+                                                      sampleRate)),
+          residual(std::make_shared<MemoryBufferAdaptor>(1, frameCount,
+                                                         sampleRate)) {
+        params.template set<0>(
+            InputBufferT::type(new fluid::VectorBufferAdaptor(
+                audio, 1, frameCount, sampleRate)),
+            nullptr);
+        params.template set<1>(LongT::type(0), nullptr);
+        params.template set<2>(LongT::type(-1), nullptr);
+        params.template set<3>(LongT::type(0), nullptr);
+        params.template set<4>(LongT::type(-1), nullptr);
+        params.template set<5>(BufferT::type(sines), nullptr);
+        params.template set<6>(BufferT::type(residual), nullptr);
+        params.template set<7>(LongT::type(settings.bandwidth), nullptr);
+        params.template set<8>(FloatT::type(settings.detectionThreshold),
+                               nullptr);
+        params.template set<9>(FloatT::type(settings.birthLowThreshold),
+                               nullptr);
+        params.template set<10>(FloatT::type(settings.birthHighThreshold),
+                                nullptr);
+        params.template set<11>(LongT::type(settings.minTrackLength),
+                                nullptr);
+        params.template set<12>(LongT::type(settings.trackingMethod), nullptr);
+        params.template set<13>(FloatT::type(settings.trackMagRange), nullptr);
+        params.template set<14>(FloatT::type(settings.trackFreqRange),
+                                nullptr);
+        params.template set<15>(FloatT::type(settings.trackProb), nullptr);
+        params.template set<16>(
+            fluid::client::FFTParams(
+                settings.windowSize, settings.hopSize, settings.fftSize,
+                std::max(settings.windowSize, settings.fftSize)),
+            nullptr);
+        client = std::make_unique<SinesClient>(params, context);
+        client->setSynchronous(false);
+    }
+
+    std::vector<float> audio;
+    FluidContext context;
+    SinesClient::ParamSetType params;
+    std::shared_ptr<MemoryBufferAdaptor> sines;
+    std::shared_ptr<MemoryBufferAdaptor> residual;
+    std::unique_ptr<SinesClient> client;
+    bool started = false;
+    bool finished = false;
+};
+
+// Clients running across all jobs. Several items are separated at once and
+// every channel's client runs on a thread of its own, so the number of
+// threads is capped here rather than per job.
+std::atomic<int> gNumRunningChannels{0};
+
+bool TryStartChannel() {
+    const int limit =
+        std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    int numRunning = gNumRunningChannels.load();
+    while (numRunning < limit) {
+        if (gNumRunningChannels.compare_exchange_weak(numRunning,
+                                                      numRunning + 1))
+            return true;
+    }
+    return false;
+}
+
+void FinishChannel() { gNumRunningChannels--; }
+
+// Copies a single channel result into channel c of out
+bool CopyChannel(MemoryBufferAdaptor *in, BufferAdaptor::Access &out,
+                 int c, int frameCount) {
+    BufferAdaptor::ReadAccess reader(in);
+    if (!reader.exists() || !reader.valid())
+        return false;
+    auto source = reader.samps(0);
+    auto destination = out.samps(c);
+    const int numFrames =
+        std::min(frameCount, static_cast<int>(reader.numFrames()));
+    for (int i = 0; i < numFrames; i++)
+        destination(i) = source(i);
+    return true;
+}
+
+} // namespace
+
+SinesAlgorithm::SinesAlgorithm(ReacomaExtension *apiProvider)
+    : AudioOutputAlgorithm<NRTThreadedSinesClient>(apiProvider) {}
+
+SinesAlgorithm::~SinesAlgorithm() = default;
+
+void SinesAlgorithm::RegisterParameters() {
+    mBaseParamIdx = mApiProvider->NParams();
+
+    for (int i = 0; i < SinesAlgorithm::kNumParams; ++i) {
+        mApiProvider->AddParam();
+    }
+
+    mApiProvider->GetParam(mBaseParamIdx + SinesAlgorithm::kBandwidth)
+        ->InitInt("Bandwidth", 76, 1, 65536);
+
+    mApiProvider->GetParam(mBaseParamIdx + SinesAlgorithm::kDetectionThreshold)
+        ->InitDouble("Detection Threshold", -96.0, -144.0, 0.0, 0.1);
+
+    mApiProvider->GetParam(mBaseParamIdx + SinesAlgorithm::kBirthLowThreshold)
+        ->InitDouble("Birth Low Threshold", -24.0, -144.0, 0.0, 0.1);
+
+    mApiProvider->GetParam(mBaseParamIdx + SinesAlgorithm::kBirthHighThreshold)
+        ->InitDouble("Birth High Threshold", -60.0, -144.0, 0.0, 0.1);
+
+    mApiProvider->GetParam(mBaseParamIdx + SinesAlgorithm::kMinTrackLength)
+        ->InitInt("Minimum Track Length", 15, 1, 1000);
+
+    IParam *methodParam =
+        mApiProvider->GetParam(mBaseParamIdx + SinesAlgorithm::kTrackingMethod);
+    methodParam->InitEnum("Tracking Method", SinesAlgorithm::kGreedy,
+                          SinesAlgorithm::kNumTrackingMethods);
+    methodParam->SetDisplayText(SinesAlgorithm::kGreedy, "Greedy");
+    methodParam->SetDisplayText(SinesAlgorithm::kHungarian, "Hungarian");
+
+    mApiProvider->GetParam(mBaseParamIdx + SinesAlgorithm::kTrackMagRange)
+        ->InitDouble("Track Magnitude Range", 15.0, 1.0, 200.0, 0.1);
+
+    mApiProvider->GetParam(mBaseParamIdx + SinesAlgorithm::kTrackFreqRange)
+        ->InitDouble("Track Frequency Range", 50.0, 1.0, 10000.0, 0.1);
+
+    mApiProvider->GetParam(mBaseParamIdx + SinesAlgorithm::kTrackProb)
+        ->InitDouble("Track Probability", 0.5, 0.0, 1.0, 0.01);
+
+    mApiProvider->GetParam(mBaseParamIdx + SinesAlgorithm::kWindowSize)
+        ->InitInt("Window Size", 1024, 2, 65536);
+
+    mApiProvider->GetParam(mBaseParamIdx + SinesAlgorithm::kHopSize)
+        ->InitInt("Hop Size", 512, 2, 65536);
+
+    mApiProvider->GetParam(mBaseParamIdx + SinesAlgorithm::kFFTSize)
+        ->InitInt("FFT Size", 1024, 2, 65536);
+}
+
+bool SinesAlgorithm::DoProcess(InputBufferT::type &sourceBuffer,
+                               int numChannels, int frameCount,
+                               int sampleRate) {
+    SinesSettings settings;
+    settings.bandwidth = GetParamInt(kBandwidth);
+    settings.detectionThreshold = GetParamValue(kDetectionThreshold);
+    settings.birthLowThreshold = GetParamValue(kBirthLowThreshold);
+    settings.birthHighThreshold = GetParamValue(kBirthHighThreshold);
+    settings.minTrackLength = GetParamInt(kMinTrackLength);
+    settings.trackingMethod = GetParamInt(kTrackingMethod);
+    settings.trackMagRange = GetParamValue(kTrackMagRange);
+    settings.trackFreqRange = GetParamValue(kTrackFreqRange);
+    settings.trackProb = GetParamValue(kTrackProb);
+    settings.windowSize = GetParamInt(kWindowSize);
+    settings.hopSize = GetParamInt(kHopSize);
+    settings.fftSize = GetParamInt(kFFTSize);
+
+    // The source buffer views audio owned by the caller, so every channel
+    // is copied for the client that separates it
+    BufferAdaptor::ReadAccess reader(sourceBuffer.get());
+    if (!reader.exists() || !reader.valid())
+        return false;
+    std::vector<std::shared_ptr<ChannelSeparation>> channels;
+    for (int c = 0; c < numChannels; c++) {
+        auto samples = reader.samps(c);
+        std::vector<float> channel(frameCount);
+        for (int i = 0; i < frameCount; i++)
+            channel[i] = samples(i);
+        channels.push_back(std::make_shared<ChannelSeparation>(
+            std::move(channel), frameCount, sampleRate, settings));
+    }
+
+    auto sinesMemoryBuffer = std::make_shared<MemoryBufferAdaptor>(
+        numChannels, frameCount, sampleRate);
+    auto resMemoryBuffer = std::make_shared<MemoryBufferAdaptor>(
+        numChannels, frameCount, sampleRate);
+    mSinesOutput = fluid::client::BufferT::type(sinesMemoryBuffer);
+    mResidualOutput = fluid::client::BufferT::type(resMemoryBuffer);
+
+    StartWorker([this, channels = std::move(channels), numChannels,
+                 frameCount, sinesMemoryBuffer, resMemoryBuffer]() {
+        auto cancelAll = [&channels]() {
+            for (auto &channel : channels) {
+                if (channel->started && !channel->finished) {
+                    channel->client->cancel();
+                    channel->finished = true;
+                    FinishChannel();
+                }
+            }
+        };
+
+        int numFinished = 0;
+        size_t next = 0;
+        while (numFinished < numChannels) {
+            if (IsWorkerCancelled()) {
+                cancelAll();
+                return false;
+            }
+
+            // Each client runs on a thread of its own
+            while (next < channels.size() && TryStartChannel()) {
+                ChannelSeparation &channel = *channels[next++];
+                channel.client->enqueue(channel.params);
+                if (!channel.client->process().ok()) {
+                    FinishChannel();
+                    cancelAll();
+                    return false;
+                }
+                channel.started = true;
+            }
+
+            double progress = 0.0;
+            for (auto &channel : channels) {
+                if (channel->finished) {
+                    progress += 1.0;
+                    continue;
+                }
+                if (!channel->started)
+                    continue;
+                Result result;
+                ProcessState state = channel->client->checkProgress(result);
+                if (state == ProcessState::kDone ||
+                    state == ProcessState::kDoneStillProcessing) {
+                    channel->finished = true;
+                    FinishChannel();
+                    if (!result.ok()) {
+                        cancelAll();
+                        return false;
+                    }
+                    numFinished++;
+                    progress += 1.0;
+                } else {
+                    progress += channel->client->progress();
+                }
+            }
+            SetWorkerProgress(0.95 * progress / numChannels);
+
+            if (numFinished < numChannels)
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        BufferAdaptor::Access sines(sinesMemoryBuffer.get());
+        BufferAdaptor::Access residual(resMemoryBuffer.get());
+        if (!sines.exists() || !residual.exists())
+            return false;
+        for (int c = 0; c < numChannels; c++) {
+            if (!CopyChannel(channels[c]->sines.get(), sines, c, frameCount) ||
+                !CopyChannel(channels[c]->residual.get(), residual, c,
+                             frameCount))
+                return false;
+        }
+        return true;
+    });
+    return true;
+}
+
+bool SinesAlgorithm::HandleResults(MediaItem *item, MediaItem_Take *take,
+                                   int numChannels, int sampleRate) {
+    AddOutputToTake(item, mSinesOutput, sampleRate, "sines");
+    AddOutputToTake(item, mResidualOutput, sampleRate, "residual");
+    return true;
+}
+
+const char *SinesAlgorithm::GetName() const {
+    return "Sinusoidal Separation";
+}
+
+int SinesAlgorithm::GetNumAlgorithmParams() const { return kNumParams; }
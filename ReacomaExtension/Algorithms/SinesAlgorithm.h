@@ -0,0 +1,45 @@
+#pragma once
+#include "../../dependencies/flucoma-core/include/flucoma/clients/rt/SinesClient.hpp"
+#include "FlucomaAlgorithmBase.h"
+
+class SinesAlgorithm
+    : public AudioOutputAlgorithm<fluid::client::NRTThreadedSinesClient> {
+  public:
+    enum Params {
+        kBandwidth = 0,
+        kDetectionThreshold,
+        kBirthLowThreshold,
+        kBirthHighThreshold,
+        kMinTrackLength,
+        kTrackingMethod,
+        kTrackMagRange,
+        kTrackFreqRange,
+        kTrackProb,
+        kWindowSize,
+        kHopSize,
+        kFFTSize,
+        kNumParams
+    };
+
+    enum ETrackingMethod { kGreedy = 0, kHungarian, kNumTrackingMethods };
+
+    SinesAlgorithm(ReacomaExtension *apiProvider);
+    ~SinesAlgorithm() override;
+
+    const char *GetName() const override;
+    void RegisterParameters() override;
+    int GetNumAlgorithmParams() const override;
+
+  protected:
+    bool DoProcess(InputBufferT::type &sourceBuffer, int numChannels,
+                   int frameCount, int sampleRate) override;
+    bool HandleResults(MediaItem *item, MediaItem_Take *take, int numChannels,
+                       int sampleRate) override;
+
+  private:
+    // Each channel is separated by a client of its own on a worker, as many
+    // at once as the cores allow across all jobs, rather than one after
+    // another by a single client
+    BufferT::type mSinesOutput;
+    BufferT::type mResidualOutput;
+};
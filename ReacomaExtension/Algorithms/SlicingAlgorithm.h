@@ -1,7 +1,18 @@
 #pragma once
 
 #include "FlucomaAlgorithmBase.h"
+#include "ItemRegions.h"
 #include "ReacomaExtension.h"
+#include "SliceSearch.h"
+#include "StageCache.h"
+#include "TakeMarkers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <string>
+#include <thread>
 
 template <typename ClientType>
 class SlicingAlgorithm : public FlucomaAlgorithm<ClientType> {
@@ -9,9 +20,109 @@ public:
     SlicingAlgorithm(ReacomaExtension *apiProvider)
         : FlucomaAlgorithm<ClientType>(apiProvider) {}
 
+    bool SupportsSplitting() override { return true; }
+
 protected:
     virtual BufferT::type &GetSlicesBuffer() = 0;
 
+    // Share of a threshold search's progress spent computing the curve
+    static constexpr double kCurveProgress = 0.5;
+
+    // Slices at the threshold that gives targetSlices rather than at a set
+    // one. The detection curve is computed by computeCurve on a worker and
+    // kept in the stage cache under curveKey, so another target or minimum
+    // slice length only searches the curve again. The curve only picks the
+    // threshold: slice then runs the slicer at it, so the slices are the
+    // ones the slicer itself finds there. hysteresis is for
+    // SliceRule::kHysteresis.
+    bool StartThresholdSearch(
+        uint64_t curveKey,
+        std::function<bool(std::vector<float> &)> computeCurve,
+        std::function<bool(double, BufferT::type)> slice, SliceRule rule,
+        int targetSlices, int minSliceFrames, int sampleRate,
+        double hysteresis = 0.0) {
+        auto outBuffer =
+            std::make_shared<MemoryBufferAdaptor>(1, 1, sampleRate);
+        GetSlicesBuffer() = BufferT::type(outBuffer);
+
+        StageCache *stageCache = this->mApiProvider->GetStageCache();
+        this->StartWorker([this, curveKey,
+                           computeCurve = std::move(computeCurve),
+                           slice = std::move(slice), rule, targetSlices,
+                           minSliceFrames, hysteresis, stageCache,
+                           outBuffer]() {
+            auto curve = stageCache->template Get<std::vector<float>>(curveKey);
+            if (!curve) {
+                auto computed = std::make_shared<std::vector<float>>();
+                if (!computeCurve(*computed) || this->IsWorkerCancelled())
+                    return false;
+                stageCache->Put(curveKey, computed,
+                                computed->size() * sizeof(float));
+                curve = computed;
+            }
+            this->SetWorkerProgress(kCurveProgress);
+
+            const double threshold = FindSliceThreshold(
+                *curve, rule, minSliceFrames, targetSlices, hysteresis);
+            return slice(threshold, BufferT::type(outBuffer));
+        });
+        return true;
+    }
+
+    // Runs a flucoma client from the worker on the client's own thread and
+    // waits for it, so that a cancelled job cancels the client instead of
+    // blocking until it finishes. Its progress is reported from
+    // progressFrom to progressTo.
+    template <typename Client>
+    bool RunClient(Client &client, typename Client::ParamSetType &params,
+                   double progressFrom, double progressTo) {
+        client.setSynchronous(false);
+        client.enqueue(params);
+        if (!client.process().ok())
+            return false;
+        while (true) {
+            if (this->IsWorkerCancelled()) {
+                client.cancel();
+                return false;
+            }
+            Result result;
+            ProcessState state = client.checkProgress(result);
+            if (state == ProcessState::kDone ||
+                state == ProcessState::kDoneStillProcessing)
+                return result.ok();
+            this->SetWorkerProgress(progressFrom + (progressTo - progressFrom) *
+                                                       client.progress());
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    // The channels of source summed into one, as the slicers analyse them.
+    // The source only lives until DoProcess() returns, so work on a worker
+    // reads a copy like this one.
+    static std::vector<float> MixDown(InputBufferT::type &source,
+                                      int numChannels, int frameCount) {
+        std::vector<float> mixdown(frameCount, 0.0f);
+        BufferAdaptor::ReadAccess reader(source.get());
+        if (!reader.exists() || !reader.valid())
+            return mixdown;
+        for (int c = 0; c < numChannels; c++) {
+            auto samples = reader.samps(c);
+            for (int i = 0; i < frameCount; i++)
+                mixdown[i] += samples(i);
+        }
+        return mixdown;
+    }
+
+    // First channel of a feature buffer written by a flucoma client
+    static bool ReadCurve(BufferT::type &features, std::vector<float> &curve) {
+        BufferAdaptor::ReadAccess reader(features.get());
+        if (!reader.exists() || !reader.valid())
+            return false;
+        auto view = reader.samps(0);
+        curve.assign(view.begin(), view.end());
+        return true;
+    }
+
 private:
     bool HandleResults(MediaItem *item, MediaItem_Take *take, int numChannels,
                        int sampleRate) override {
@@ -23,12 +134,25 @@ private:
         auto mode = this->mApiProvider->GetCurrentMode();
         if (mode == ReacomaExtension::Mode::Regions) {
             CreateRegionsFromSlices(item, slices, sampleRate);
+        } else if (mode == ReacomaExtension::Mode::Split) {
+            SplitItemAtSlices(item, take, slices, sampleRate);
         } else {
             CreateTakeMarkers(item, take, slices, sampleRate);
         }
         return true;
     }
 
+    bool StoreResults(AnalysisResult &result) override {
+        return this->StoreSlices(GetSlicesBuffer(), result);
+    }
+
+    bool RestoreResults(MediaItem *item, MediaItem_Take *take, int numChannels,
+                        int sampleRate, const AnalysisResult &result) override {
+        if (!this->RestoreSlices(result, GetSlicesBuffer(), sampleRate))
+            return false;
+        return HandleResults(item, take, numChannels, sampleRate);
+    }
+
     // The helper methods are now part of this base class.
     void CreateTakeMarkers(MediaItem *item, MediaItem_Take *take,
                            BufferT::type &slices, int sampleRate) {
@@ -36,20 +160,21 @@ private:
         if (!reader.exists() || !reader.valid())
             return;
 
-        int markerCount = GetNumTakeMarkers(take);
-        for (int i = markerCount - 1; i >= 0; i--)
-            DeleteTakeMarker(take, i);
-
         double itemLength = GetMediaItemInfo_Value(item, "D_LENGTH");
         auto view = reader.samps(0);
+        std::vector<TakeMarker> markers;
+        markers.reserve(view.size());
         for (fluid::index i = 0; i < view.size(); i++) {
             if (view(i) > 0) {
                 double markerTimeInSeconds =
                     static_cast<double>(view(i)) / sampleRate;
                 if (markerTimeInSeconds < itemLength)
-                    SetTakeMarker(take, -1, "", &markerTimeInSeconds, nullptr);
+                    markers.push_back({markerTimeInSeconds});
             }
         }
+
+        // Markers already within half a sample of a slice are left alone
+        ApplyTakeMarkers(take, std::move(markers), 0.5 / sampleRate);
     }
 
     void CreateRegionsFromSlices(MediaItem *item, BufferT::type &slices,
@@ -58,10 +183,6 @@ private:
         if (!reader.exists() || !reader.valid())
             return;
 
-        ReaProject *project = GetItemProjectContext(item);
-        if (!project)
-            return;
-
         double itemPos = GetMediaItemInfo_Value(item, "D_POSITION");
         double itemLen = GetMediaItemInfo_Value(item, "D_LENGTH");
 
@@ -88,6 +209,8 @@ private:
                          sliceTimes.end());
 
         // Loop through pairs of slice points to create regions
+        std::vector<ItemRegion> regions;
+        regions.reserve(sliceTimes.size());
         for (size_t i = 0; i < sliceTimes.size() - 1; ++i) {
             double regionStart = itemPos + sliceTimes[i];
             double regionEnd = itemPos + sliceTimes[i + 1];
@@ -96,8 +219,134 @@ private:
             if (regionEnd > regionStart) {
                 char name[64];
                 snprintf(name, sizeof(name), "Region %zu", i + 1);
-                AddProjectMarker2(project, true, regionStart, regionEnd, name,
-                                  -1, 0);
+                regions.push_back({regionStart, regionEnd, name});
+            }
+        }
+
+        // Replaces the regions of the previous run on this item
+        ApplyItemRegions(item, regions);
+    }
+
+    void SplitItemAtSlices(MediaItem *item, MediaItem_Take *take,
+                           BufferT::type &slices, int sampleRate) {
+        BufferAdaptor::ReadAccess reader(slices.get());
+        if (!reader.exists() || !reader.valid())
+            return;
+
+        double itemPos = GetMediaItemInfo_Value(item, "D_POSITION");
+        double itemLen = GetMediaItemInfo_Value(item, "D_LENGTH");
+        double playrate = GetMediaItemTakeInfo_Value(take, "D_PLAYRATE");
+        if (playrate <= 0.0)
+            playrate = 1.0;
+
+        // Slices are in source time, splits in project time
+        auto view = reader.samps(0);
+        std::vector<double> splitTimes;
+        splitTimes.reserve(view.size());
+        for (fluid::index i = 0; i < view.size(); i++) {
+            if (view(i) > 0) {
+                double timeInSeconds =
+                    static_cast<double>(view(i)) / sampleRate / playrate;
+                if (timeInSeconds < itemLen)
+                    splitTimes.push_back(itemPos + timeInSeconds);
+            }
+        }
+
+        std::sort(splitTimes.begin(), splitTimes.end());
+        splitTimes.erase(std::unique(splitTimes.begin(), splitTimes.end()),
+                         splitTimes.end());
+
+        // The item is still locked while it is being processed
+        SetMediaItemInfo_Value(item, "C_LOCK", false);
+
+        // Every split copies all take markers to the new item, which costs
+        // more than the splits themselves once there are many slices. The
+        // markers are taken off first and each is put back on the one piece
+        // it falls in.
+        PreventUIRefresh(1);
+        std::vector<std::vector<NamedTakeMarker>> markers =
+            RemoveTakeMarkers(item);
+
+        // Cutting from the end only ever shortens the original item, so
+        // every split point stays inside it and no item is split twice.
+        // The batch's undo block makes this a single undo point.
+        std::vector<MediaItem *> pieces;
+        for (auto it = splitTimes.rbegin(); it != splitTimes.rend(); ++it) {
+            if (MediaItem *piece = SplitMediaItem(item, *it))
+                pieces.push_back(piece);
+        }
+        pieces.push_back(item);
+        std::reverse(pieces.begin(), pieces.end());
+
+        RestoreTakeMarkers(pieces, markers);
+        PreventUIRefresh(-1);
+    }
+
+private:
+    struct NamedTakeMarker {
+        TakeMarker marker;
+        std::string name;
+    };
+
+    // Markers of each take of item, sorted by position
+    static std::vector<std::vector<NamedTakeMarker>>
+    RemoveTakeMarkers(MediaItem *item) {
+        std::vector<std::vector<NamedTakeMarker>> markers(CountTakes(item));
+        for (size_t t = 0; t < markers.size(); t++) {
+            MediaItem_Take *take = GetTake(item, static_cast<int>(t));
+            if (!take)
+                continue;
+            const int numMarkers = GetNumTakeMarkers(take);
+            for (int i = 0; i < numMarkers; i++) {
+                char name[256] = "";
+                NamedTakeMarker named;
+                named.marker.position = GetTakeMarker(
+                    take, i, name, sizeof(name), &named.marker.color);
+                named.name = name;
+                markers[t].push_back(std::move(named));
+            }
+            for (int i = numMarkers - 1; i >= 0; i--)
+                DeleteTakeMarker(take, i);
+            std::stable_sort(markers[t].begin(), markers[t].end(),
+                             [](const NamedTakeMarker &a,
+                                const NamedTakeMarker &b) {
+                                 return a.marker.position < b.marker.position;
+                             });
+        }
+        return markers;
+    }
+
+    // Puts each marker on the piece, in timeline order, whose part of the
+    // source contains it. Markers before the first piece or after the last
+    // stay with those, as they would have on the unsplit item.
+    static void RestoreTakeMarkers(
+        const std::vector<MediaItem *> &pieces,
+        const std::vector<std::vector<NamedTakeMarker>> &markers) {
+        for (size_t t = 0; t < markers.size(); t++) {
+            const auto &takeMarkers = markers[t];
+            size_t next = 0;
+            for (size_t p = 0; p < pieces.size() && next < takeMarkers.size();
+                 p++) {
+                MediaItem_Take *take = GetTake(pieces[p], static_cast<int>(t));
+                if (!take)
+                    continue;
+                double end = std::numeric_limits<double>::infinity();
+                if (p + 1 < pieces.size()) {
+                    const double playrate =
+                        GetMediaItemTakeInfo_Value(take, "D_PLAYRATE");
+                    end = GetMediaItemTakeInfo_Value(take, "D_STARTOFFS") +
+                          GetMediaItemInfo_Value(pieces[p], "D_LENGTH") *
+                              (playrate > 0.0 ? playrate : 1.0);
+                }
+                for (; next < takeMarkers.size() &&
+                       takeMarkers[next].marker.position < end;
+                     next++) {
+                    const NamedTakeMarker &named = takeMarkers[next];
+                    double position = named.marker.position;
+                    int color = named.marker.color;
+                    SetTakeMarker(take, -1, named.name.c_str(), &position,
+                                  color != 0 ? &color : nullptr);
+                }
             }
         }
     }
@@ -1,9 +1,9 @@
 #pragma once
 #include "../../dependencies/flucoma-core/include/flucoma/clients/rt/TransientSliceClient.hpp"
-#include "FlucomaAlgorithmBase.h"
+#include "SlicingAlgorithm.h"
 
 class TransientSliceAlgorithm
-    : public FlucomaAlgorithm<fluid::client::NRTThreadedTransientSliceClient> {
+    : public SlicingAlgorithm<fluid::client::NRTThreadedTransientSliceClient> {
   public:
     enum Params {
         kOrder = 0,
@@ -26,8 +26,7 @@ class TransientSliceAlgorithm
     int GetNumAlgorithmParams() const override;
 
   protected:
+    BufferT::type &GetSlicesBuffer() override;
     bool DoProcess(InputBufferT::type &sourceBuffer, int numChannels,
                    int frameCount, int sampleRate) override;
-    bool HandleResults(MediaItem *item, MediaItem_Take *take, int numChannels,
-                       int sampleRate) override;
 };
@@ -0,0 +1,302 @@
+#include "AnalysisCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kMagic = 0x52434143; // "RCAC"
+constexpr const char *kEntryExtension = ".rcache";
+
+class EntryWriter {
+public:
+    explicit EntryWriter(FILE *file) : mFile(file) {}
+
+    template <typename T> void Write(const T &value) {
+        mOk = mOk && fwrite(&value, sizeof(T), 1, mFile) == 1;
+    }
+
+    template <typename T> void WriteArray(const std::vector<T> &values) {
+        Write<uint64_t>(values.size());
+        if (!values.empty())
+            mOk = mOk && fwrite(values.data(), sizeof(T), values.size(),
+                                mFile) == values.size();
+    }
+
+    void WriteString(const std::string &str) {
+        Write<uint64_t>(str.size());
+        if (!str.empty())
+            mOk = mOk && fwrite(str.data(), 1, str.size(), mFile) == str.size();
+    }
+
+    bool Ok() const { return mOk; }
+
+private:
+    FILE *mFile;
+    bool mOk = true;
+};
+
+class EntryReader {
+public:
+    EntryReader(FILE *file, uint64_t fileSize)
+        : mFile(file), mRemaining(fileSize) {}
+
+    template <typename T> bool Read(T &value) {
+        if (!Consume(sizeof(T)))
+            return false;
+        mOk = fread(&value, sizeof(T), 1, mFile) == 1;
+        return mOk;
+    }
+
+    template <typename T> bool ReadArray(std::vector<T> &values) {
+        uint64_t count = 0;
+        if (!Read(count) || count > mRemaining / sizeof(T))
+            return mOk = false;
+        values.resize(count);
+        if (count == 0)
+            return true;
+        mRemaining -= count * sizeof(T);
+        mOk = fread(values.data(), sizeof(T), count, mFile) == count;
+        return mOk;
+    }
+
+    bool ReadString(std::string &str) {
+        uint64_t length = 0;
+        if (!Read(length) || length > mRemaining)
+            return mOk = false;
+        str.resize(length);
+        if (length == 0)
+            return true;
+        mRemaining -= length;
+        mOk = fread(&str[0], 1, length, mFile) == length;
+        return mOk;
+    }
+
+private:
+    bool Consume(uint64_t size) {
+        if (!mOk || size > mRemaining)
+            return mOk = false;
+        mRemaining -= size;
+        return true;
+    }
+
+    FILE *mFile;
+    uint64_t mRemaining;
+    bool mOk = true;
+};
+
+bool WriteEntry(const std::filesystem::path &path, uint64_t key,
+                const AnalysisResult &result) {
+    FILE *file = fopen(path.string().c_str(), "wb");
+    if (!file)
+        return false;
+
+    EntryWriter writer(file);
+    writer.Write(kMagic);
+    writer.Write(AnalysisCache::kVersion);
+    writer.Write(key);
+
+    writer.Write<uint64_t>(result.slices.size());
+    for (const auto &channel : result.slices)
+        writer.WriteArray(channel);
+
+    writer.Write<int32_t>(result.curveHopSize);
+    writer.WriteArray(result.curve);
+
+    writer.Write<uint64_t>(result.outputs.size());
+    for (const auto &output : result.outputs) {
+        writer.WriteString(output.path);
+        writer.WriteString(output.takeName);
+        writer.WriteString(output.suffix);
+        writer.WriteString(output.takeSuffix);
+        writer.Write<int32_t>(output.channelMode);
+    }
+
+    bool ok = writer.Ok();
+    return fclose(file) == 0 && ok;
+}
+
+bool ReadEntry(const std::filesystem::path &path, uint64_t size, uint64_t key,
+               AnalysisResult &result) {
+    FILE *file = fopen(path.string().c_str(), "rb");
+    if (!file)
+        return false;
+
+    EntryReader reader(file, size);
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint64_t storedKey = 0;
+    bool ok = reader.Read(magic) && magic == kMagic &&
+              reader.Read(version) && version == AnalysisCache::kVersion &&
+              reader.Read(storedKey) && storedKey == key;
+
+    uint64_t numSliceChannels = 0;
+    ok = ok && reader.Read(numSliceChannels) && numSliceChannels <= size;
+    if (ok) {
+        result.slices.resize(numSliceChannels);
+        for (auto &channel : result.slices)
+            ok = ok && reader.ReadArray(channel);
+    }
+
+    int32_t curveHopSize = 0;
+    ok = ok && reader.Read(curveHopSize) && reader.ReadArray(result.curve);
+    result.curveHopSize = curveHopSize;
+
+    uint64_t numOutputs = 0;
+    ok = ok && reader.Read(numOutputs) && numOutputs <= size;
+    if (ok) {
+        result.outputs.resize(numOutputs);
+        for (auto &output : result.outputs) {
+            int32_t channelMode = 0;
+            ok = ok && reader.ReadString(output.path) &&
+                 reader.ReadString(output.takeName) &&
+                 reader.ReadString(output.suffix) &&
+                 reader.ReadString(output.takeSuffix) &&
+                 reader.Read(channelMode);
+            output.channelMode = channelMode;
+        }
+    }
+
+    fclose(file);
+    return ok;
+}
+
+} // namespace
+
+AnalysisCache::AnalysisCache(const std::string &directory, uint64_t maxBytes)
+    : mDirectory(directory), mMaxBytes(maxBytes) {
+    std::error_code ec;
+    std::filesystem::create_directories(mDirectory, ec);
+    ScanDirectory();
+    EvictToFit();
+}
+
+bool AnalysisCache::Lookup(uint64_t key, AnalysisResult &result) {
+    auto it = mEntries.find(key);
+    if (it == mEntries.end())
+        return false;
+
+    const auto path = GetEntryPath(key);
+    AnalysisResult loaded;
+    if (!ReadEntry(path, it->second.size, key, loaded)) {
+        // Stale version or damaged file, drop it so it isn't read again
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        Remove(key);
+        return false;
+    }
+
+    mLru.splice(mLru.begin(), mLru, it->second.lruPosition);
+    std::error_code ec;
+    std::filesystem::last_write_time(
+        path, std::filesystem::file_time_type::clock::now(), ec);
+
+    result = std::move(loaded);
+    return true;
+}
+
+void AnalysisCache::Store(uint64_t key, const AnalysisResult &result) {
+    if (result.IsEmpty())
+        return;
+
+    const auto path = GetEntryPath(key);
+    auto tempPath = path;
+    tempPath += ".tmp";
+
+    std::error_code ec;
+    if (!WriteEntry(tempPath, key, result)) {
+        std::filesystem::remove(tempPath, ec);
+        return;
+    }
+    std::filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        std::filesystem::remove(tempPath, ec);
+        return;
+    }
+
+    const uint64_t size = std::filesystem::file_size(path, ec);
+    if (ec)
+        return;
+
+    Remove(key);
+    Insert(key, size);
+    EvictToFit();
+}
+
+void AnalysisCache::Clear() {
+    std::error_code ec;
+    for (const auto &entry : mEntries)
+        std::filesystem::remove(GetEntryPath(entry.first), ec);
+    mEntries.clear();
+    mLru.clear();
+    mTotalBytes = 0;
+}
+
+std::filesystem::path AnalysisCache::GetEntryPath(uint64_t key) const {
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+    return mDirectory / (std::string(name) + kEntryExtension);
+}
+
+void AnalysisCache::ScanDirectory() {
+    struct Found {
+        uint64_t key;
+        uint64_t size;
+        std::filesystem::file_time_type lastUse;
+    };
+    std::vector<Found> found;
+
+    std::error_code ec;
+    for (const auto &file :
+         std::filesystem::directory_iterator(mDirectory, ec)) {
+        const auto &path = file.path();
+        if (path.extension() != kEntryExtension)
+            continue;
+
+        const std::string stem = path.stem().string();
+        char *end = nullptr;
+        const uint64_t key = strtoull(stem.c_str(), &end, 16);
+        if (stem.empty() || *end != '\0')
+            continue;
+
+        std::error_code fileEc;
+        const uint64_t size = file.file_size(fileEc);
+        const auto lastUse = file.last_write_time(fileEc);
+        if (!fileEc)
+            found.push_back({key, size, lastUse});
+    }
+
+    // Oldest first, so each Insert() pushes a more recent entry to the front
+    std::sort(found.begin(), found.end(),
+              [](const Found &a, const Found &b) {
+                  return a.lastUse < b.lastUse;
+              });
+    for (const auto &entry : found)
+        Insert(entry.key, entry.size);
+}
+
+void AnalysisCache::Insert(uint64_t key, uint64_t size) {
+    mLru.push_front(key);
+    mEntries[key] = Entry{size, mLru.begin()};
+    mTotalBytes += size;
+}
+
+void AnalysisCache::Remove(uint64_t key) {
+    auto it = mEntries.find(key);
+    if (it == mEntries.end())
+        return;
+    mTotalBytes -= it->second.size;
+    mLru.erase(it->second.lruPosition);
+    mEntries.erase(it);
+}
+
+void AnalysisCache::EvictToFit() {
+    std::error_code ec;
+    while (mTotalBytes > mMaxBytes && !mLru.empty()) {
+        const uint64_t key = mLru.back();
+        std::filesystem::remove(GetEntryPath(key), ec);
+        Remove(key);
+    }
+}
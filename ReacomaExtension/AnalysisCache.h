@@ -0,0 +1,50 @@
+#pragma once
+
+#include "AnalysisResult.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+// Persistent store of analysis results, one file per entry, keyed by a hash
+// of the source audio range and the parameters that produced the result.
+// Entries are evicted least-recently-used first once the total size exceeds
+// the limit. The file modification time doubles as the LRU timestamp so the
+// ordering survives restarts. Only used from the main thread.
+class AnalysisCache {
+public:
+    // Bump whenever the entry layout or the meaning of a key changes
+    static constexpr uint32_t kVersion = 3;
+    static constexpr uint64_t kDefaultMaxBytes = 256ull * 1024 * 1024;
+
+    AnalysisCache(const std::string &directory,
+                  uint64_t maxBytes = kDefaultMaxBytes);
+
+    bool Lookup(uint64_t key, AnalysisResult &result);
+    void Store(uint64_t key, const AnalysisResult &result);
+    void Clear();
+
+    uint64_t GetTotalBytes() const { return mTotalBytes; }
+
+private:
+    struct Entry {
+        uint64_t size;
+        std::list<uint64_t>::iterator lruPosition;
+    };
+
+    std::filesystem::path GetEntryPath(uint64_t key) const;
+    void ScanDirectory();
+    void Insert(uint64_t key, uint64_t size);
+    void Remove(uint64_t key);
+    void EvictToFit();
+
+    std::filesystem::path mDirectory;
+    uint64_t mMaxBytes;
+    uint64_t mTotalBytes = 0;
+
+    // Most recently used at the front
+    std::list<uint64_t> mLru;
+    std::unordered_map<uint64_t, Entry> mEntries;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+// The reusable outcome of running an algorithm over one item: everything
+// needed to reapply the result without analysing the audio again.
+struct AnalysisResult {
+    struct Output {
+        std::string path;
+        std::string takeName;
+        // Identify the output among those of its algorithm; takes reading
+        // channel ranges of one file share its suffix
+        std::string suffix;
+        std::string takeSuffix;
+        // I_CHANMODE of the take
+        int channelMode = 0;
+        // Interleaved audio of a preview shown before it was committed,
+        // held in memory instead of at path. Such results are only memoised,
+        // never stored on disk.
+        std::shared_ptr<const std::vector<float>> audio;
+        int numChans = 0;
+        int sampleRate = 0;
+    };
+
+    // Slice points in samples, one list per output channel of the slicer
+    std::vector<std::vector<double>> slices;
+
+    // Feature curve, one value every curveHopSize samples
+    std::vector<float> curve;
+    int curveHopSize = 0;
+
+    // Rendered files that were added to the item as takes
+    std::vector<Output> outputs;
+
+    bool IsEmpty() const {
+        return slices.empty() && curve.empty() && outputs.empty();
+    }
+
+    bool HoldsAudio() const {
+        for (const auto &output : outputs) {
+            if (output.audio)
+                return true;
+        }
+        return false;
+    }
+};
@@ -0,0 +1,294 @@
+#include "CorpusIndex.h"
+#include "OpenFile.h"
+
+#include "../dependencies/flucoma-core/include/flucoma/algorithms/public/KDTree.hpp"
+#include "../dependencies/flucoma-core/include/flucoma/data/FluidDataSet.hpp"
+#include "../dependencies/flucoma-core/include/flucoma/data/TensorTypes.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <set>
+#include <type_traits>
+
+namespace {
+
+constexpr uint32_t kMagic = 0x52434349; // "RCCI"
+
+// Slices are stored as they are in memory
+static_assert(std::is_trivially_copyable<SliceDescriptors>::value,
+              "SliceDescriptors is written byte for byte");
+
+class IndexWriter {
+public:
+    template <typename T> void Write(const T &value) {
+        mData.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    void WriteString(const std::string &str) {
+        Write<uint32_t>(static_cast<uint32_t>(str.size()));
+        mData += str;
+    }
+
+    std::string Take() { return std::move(mData); }
+
+private:
+    std::string mData;
+};
+
+class IndexReader {
+public:
+    explicit IndexReader(const std::string &data) : mData(data) {}
+
+    template <typename T> bool Read(T &value) {
+        if (!mOk || mData.size() - mPosition < sizeof(T))
+            return mOk = false;
+        std::memcpy(&value, mData.data() + mPosition, sizeof(T));
+        mPosition += sizeof(T);
+        return true;
+    }
+
+    bool ReadString(std::string &str) {
+        uint32_t length = 0;
+        if (!Read(length) || mData.size() - mPosition < length)
+            return mOk = false;
+        str.assign(mData, mPosition, length);
+        mPosition += length;
+        return true;
+    }
+
+    // Guards counts against a truncated or corrupt file
+    bool ReadCount(uint32_t &count, size_t minItemSize) {
+        if (!Read(count))
+            return false;
+        if (count > (mData.size() - mPosition) / minItemSize)
+            return mOk = false;
+        return true;
+    }
+
+private:
+    const std::string &mData;
+    size_t mPosition = 0;
+    bool mOk = true;
+};
+
+int64_t GetModifiedTime(const std::string &path) {
+    std::error_code ec;
+    auto time = std::filesystem::last_write_time(std::filesystem::u8path(path),
+                                                 ec);
+    return ec ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+} // namespace
+
+CorpusIndex::CorpusIndex() = default;
+CorpusIndex::~CorpusIndex() = default;
+
+bool CorpusIndex::Load(const std::string &path) {
+    FILE *file = OpenFile(std::filesystem::u8path(path), "rb");
+    if (!file)
+        return false;
+    std::string data;
+    char buffer[65536];
+    size_t numRead;
+    while ((numRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.append(buffer, numRead);
+    fclose(file);
+
+    IndexReader reader(data);
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t numTakes = 0;
+    if (!reader.Read(magic) || magic != kMagic || !reader.Read(version) ||
+        version != kVersion || !reader.ReadCount(numTakes, 20))
+        return false;
+
+    std::map<std::string, TakeSlices> takes;
+    for (uint32_t t = 0; t < numTakes; t++) {
+        std::string id;
+        uint32_t numSlices = 0;
+        if (!reader.ReadString(id))
+            return false;
+        TakeSlices &take = takes[id];
+        if (!reader.ReadString(take.descriptorPath) ||
+            !reader.Read(take.modified) ||
+            !reader.ReadCount(numSlices, sizeof(SliceDescriptors)))
+            return false;
+        take.slices.resize(numSlices);
+        for (auto &slice : take.slices) {
+            if (!reader.Read(slice))
+                return false;
+        }
+    }
+
+    mTakes = std::move(takes);
+    mIsStale = true;
+    return true;
+}
+
+std::string CorpusIndex::Serialise() const {
+    IndexWriter writer;
+    writer.Write(kMagic);
+    writer.Write(kVersion);
+    writer.Write<uint32_t>(static_cast<uint32_t>(mTakes.size()));
+    for (const auto &entry : mTakes) {
+        const TakeSlices &take = entry.second;
+        writer.WriteString(entry.first);
+        writer.WriteString(take.descriptorPath);
+        writer.Write(take.modified);
+        writer.Write<uint32_t>(static_cast<uint32_t>(take.slices.size()));
+        for (const auto &slice : take.slices)
+            writer.Write(slice);
+    }
+    return writer.Take();
+}
+
+bool CorpusIndex::Update(
+    const std::vector<Take> &takes,
+    const std::function<bool(const std::string &)> &takeExists) {
+    bool changed = false;
+
+    // Reads the take's file unless it is unchanged since it was last read
+    auto refresh = [&changed](TakeSlices &slices, const std::string &path) {
+        const int64_t modified = GetModifiedTime(path);
+        if (slices.descriptorPath == path && slices.modified == modified &&
+            modified != 0)
+            return;
+
+        slices.descriptorPath = path;
+        slices.modified = modified;
+        // An unreadable file leaves the take without slices until it is
+        // written again
+        if (!ReadDescriptorFile(path, slices.slices))
+            slices.slices.clear();
+        changed = true;
+    };
+
+    std::set<std::string> ids;
+    for (const Take &take : takes) {
+        ids.insert(take.id);
+        refresh(mTakes[take.id], take.descriptorPath);
+    }
+
+    for (auto it = mTakes.begin(); it != mTakes.end();) {
+        if (ids.count(it->first)) {
+            ++it;
+            continue;
+        }
+        std::error_code ec;
+        const std::string &path = it->second.descriptorPath;
+        if (takeExists(it->first) &&
+            std::filesystem::exists(std::filesystem::u8path(path), ec)) {
+            refresh(it->second, path);
+            ++it;
+        } else {
+            it = mTakes.erase(it);
+            changed = true;
+        }
+    }
+
+    if (changed)
+        mIsStale = true;
+    return changed;
+}
+
+bool CorpusIndex::FindSlice(const std::string &takeId, double position,
+                            SliceDescriptors &slice) const {
+    auto take = mTakes.find(takeId);
+    if (take == mTakes.end())
+        return false;
+    for (const auto &candidate : take->second.slices) {
+        if (position >= candidate.start && position < candidate.end) {
+            slice = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<CorpusIndex::Match>
+CorpusIndex::FindNearest(const std::string &takeId,
+                         const SliceDescriptors &slice, int k) {
+    if (mIsStale)
+        Rebuild();
+
+    std::vector<Match> matches;
+    if (!mTree || k <= 0)
+        return matches;
+
+    const Features features = GetFeatures(slice);
+    fluid::RealVector point(kNumFeatures);
+    for (int d = 0; d < kNumFeatures; d++)
+        point(d) = (features[d] - mMean[d]) * mScale[d];
+
+    // One more than asked for, as the slice itself is nearest
+    auto nearest = mTree->kNearest(point, k + 1);
+    for (size_t i = 0; i < nearest.second.size(); i++) {
+        const SliceRef &ref = mSlices[std::stoul(*nearest.second[i])];
+        if (*ref.takeId == takeId && ref.slice->start == slice.start)
+            continue;
+        if (static_cast<int>(matches.size()) < k)
+            matches.push_back({*ref.takeId, *ref.slice, nearest.first[i]});
+    }
+    return matches;
+}
+
+CorpusIndex::Features CorpusIndex::GetFeatures(const SliceDescriptors &slice) {
+    Features features;
+    features[0] = slice.loudness;
+    // Octaves, so that a change in brightness counts the same anywhere in
+    // the spectrum
+    features[1] = std::log2(std::max(slice.centroid, 20.f));
+    features[2] = slice.pitchConfidence;
+    // The first MFCC follows the level, which loudness already measures
+    for (int i = 1; i < SliceDescriptors::kNumMFCCs; i++)
+        features[2 + i] = slice.mfcc[i];
+    return features;
+}
+
+void CorpusIndex::Rebuild() {
+    mIsStale = false;
+    mSlices.clear();
+    mTree.reset();
+
+    for (const auto &entry : mTakes) {
+        for (const auto &slice : entry.second.slices)
+            mSlices.push_back({&entry.first, &slice});
+    }
+    if (mSlices.empty())
+        return;
+
+    std::vector<Features> features(mSlices.size());
+    Features sum{};
+    Features sumOfSquares{};
+    for (size_t i = 0; i < mSlices.size(); i++) {
+        features[i] = GetFeatures(*mSlices[i].slice);
+        for (int d = 0; d < kNumFeatures; d++) {
+            sum[d] += features[i][d];
+            sumOfSquares[d] += features[i][d] * features[i][d];
+        }
+    }
+
+    const double count = static_cast<double>(mSlices.size());
+    for (int d = 0; d < kNumFeatures; d++) {
+        mMean[d] = sum[d] / count;
+        const double variance =
+            std::max(sumOfSquares[d] / count - mMean[d] * mMean[d], 0.0);
+        // A descriptor that is the same for every slice doesn't separate
+        // any of them
+        mScale[d] = variance > 1e-12 ? 1.0 / std::sqrt(variance) : 0.0;
+    }
+
+    // The tree is balanced when built from a whole data set, which adding
+    // the points one at a time wouldn't guarantee
+    fluid::FluidDataSet<std::string, double, 1> dataSet(kNumFeatures);
+    fluid::RealVector point(kNumFeatures);
+    for (size_t i = 0; i < mSlices.size(); i++) {
+        for (int d = 0; d < kNumFeatures; d++)
+            point(d) = (features[i][d] - mMean[d]) * mScale[d];
+        dataSet.add(std::to_string(i), point);
+    }
+    mTree = std::make_unique<fluid::algorithm::KDTree>(dataSet);
+}
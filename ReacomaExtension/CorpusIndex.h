@@ -0,0 +1,94 @@
+#pragma once
+
+#include "SliceDescriptors.h"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace fluid {
+namespace algorithm {
+class KDTree;
+}
+} // namespace fluid
+
+// The slices of every described take, searchable by how alike they sound.
+// Slices are read from the takes' descriptor files; a file is only read
+// again once it has changed on disk, so updating the index after re-slicing
+// one item doesn't read the others. The descriptors kept are written with a
+// SettingsWriter and loaded on the next run. Distances are measured between
+// descriptors standardised over the whole index, so that no descriptor
+// outweighs the others by its units, in a flucoma KD-tree that is rebuilt
+// whenever the set of slices changes. Only used from the main thread.
+class CorpusIndex {
+public:
+    // Bump whenever the layout of the serialised index changes
+    static constexpr uint32_t kVersion = 1;
+
+    struct Take {
+        // Take GUID
+        std::string id;
+        std::string descriptorPath;
+    };
+
+    struct Match {
+        std::string takeId;
+        SliceDescriptors slice;
+        double distance;
+    };
+
+    CorpusIndex();
+    ~CorpusIndex();
+
+    // Replaces the index with the one in path; false if it can't be read
+    bool Load(const std::string &path);
+    std::string Serialise() const;
+
+    // Adds the slices of takes, or reads them again if their file changed,
+    // and likewise refreshes every other take already indexed. A take is
+    // dropped once its descriptor file is gone or takeExists returns false
+    // for its GUID. True if any slices were added or removed.
+    bool Update(const std::vector<Take> &takes,
+                const std::function<bool(const std::string &)> &takeExists);
+
+    // The slice of the take that contains position, in seconds from the
+    // start of the take's source
+    bool FindSlice(const std::string &takeId, double position,
+                   SliceDescriptors &slice) const;
+    // The k slices nearest to slice, nearest first, without slice itself
+    std::vector<Match> FindNearest(const std::string &takeId,
+                                   const SliceDescriptors &slice, int k);
+
+private:
+    struct TakeSlices {
+        std::string descriptorPath;
+        // Modification time of the file when it was read
+        int64_t modified = 0;
+        std::vector<SliceDescriptors> slices;
+    };
+
+    struct SliceRef {
+        const std::string *takeId;
+        const SliceDescriptors *slice;
+    };
+
+    static constexpr int kNumFeatures = 3 + SliceDescriptors::kNumMFCCs - 1;
+    using Features = std::array<double, kNumFeatures>;
+
+    static Features GetFeatures(const SliceDescriptors &slice);
+    void Rebuild();
+
+    // By take GUID
+    std::map<std::string, TakeSlices> mTakes;
+
+    // Built from mTakes when first searched after a change
+    bool mIsStale = true;
+    std::vector<SliceRef> mSlices;
+    Features mMean{};
+    Features mScale{};
+    std::unique_ptr<fluid::algorithm::KDTree> mTree;
+};
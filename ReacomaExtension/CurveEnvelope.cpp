@@ -0,0 +1,140 @@
+#include "CurveEnvelope.h"
+
+#include "wdltypes.h"
+#include "reaper_plugin_functions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+constexpr const char *kOwnedKey = "P_EXT:reacoma_curve";
+// Of the curve once scaled to 0..1
+constexpr float kTolerance = 0.005f;
+// Past the end of any take
+constexpr double kEndOfTime = 1e10;
+
+bool IsOwned(MediaItem_Take *take) {
+    char value[8] = "";
+    return GetSetMediaItemTakeInfo_String(take, kOwnedKey, value, false) &&
+           value[0] == '1';
+}
+
+void SetOwned(MediaItem_Take *take, bool owned) {
+    char value[2] = {owned ? '1' : '\0', '\0'};
+    GetSetMediaItemTakeInfo_String(take, kOwnedKey, value, true);
+}
+
+// Creates the take's volume envelope with REAPER's own action, which works
+// on the active takes of the selected items. Rewriting the item's state
+// instead would recreate its sources, losing those of preview takes that
+// only exist in memory.
+TrackEnvelope *CreateVolumeEnvelope(MediaItem *item, MediaItem_Take *take) {
+    constexpr int kToggleTakeVolumeEnvelope = 40693;
+
+    std::vector<MediaItem *> selected(CountSelectedMediaItems(nullptr));
+    for (size_t i = 0; i < selected.size(); i++)
+        selected[i] = GetSelectedMediaItem(nullptr, static_cast<int>(i));
+    MediaItem_Take *activeTake = GetActiveTake(item);
+    // The item is still locked while it is being processed
+    const double locked = GetMediaItemInfo_Value(item, "C_LOCK");
+
+    PreventUIRefresh(1);
+    SetMediaItemInfo_Value(item, "C_LOCK", 0.0);
+    SelectAllMediaItems(nullptr, false);
+    SetMediaItemSelected(item, true);
+    SetActiveTake(take);
+    Main_OnCommand(kToggleTakeVolumeEnvelope, 0);
+    if (activeTake)
+        SetActiveTake(activeTake);
+    SelectAllMediaItems(nullptr, false);
+    for (MediaItem *selectedItem : selected)
+        SetMediaItemSelected(selectedItem, true);
+    SetMediaItemInfo_Value(item, "C_LOCK", locked);
+    PreventUIRefresh(-1);
+
+    return GetTakeEnvelopeByName(take, "Volume");
+}
+
+} // namespace
+
+std::vector<size_t> DecimateCurve(const std::vector<float> &curve,
+                                  float tolerance) {
+    std::vector<size_t> kept;
+    if (curve.empty())
+        return kept;
+    kept.push_back(0);
+    if (curve.size() == 1)
+        return kept;
+    kept.push_back(curve.size() - 1);
+
+    // Spans still to be checked, without recursion so that long curves
+    // can't exhaust the stack
+    std::vector<std::pair<size_t, size_t>> spans{{0, curve.size() - 1}};
+    while (!spans.empty()) {
+        const auto [first, last] = spans.back();
+        spans.pop_back();
+
+        const double slope =
+            (double(curve[last]) - curve[first]) / double(last - first);
+        double maxError = tolerance;
+        size_t worst = 0;
+        for (size_t i = first + 1; i < last; i++) {
+            const double line = curve[first] + slope * double(i - first);
+            const double error = std::abs(curve[i] - line);
+            if (error > maxError) {
+                maxError = error;
+                worst = i;
+            }
+        }
+        if (worst != 0) {
+            kept.push_back(worst);
+            spans.push_back({first, worst});
+            spans.push_back({worst, last});
+        }
+    }
+    std::sort(kept.begin(), kept.end());
+    return kept;
+}
+
+bool ApplyCurveEnvelope(MediaItem *item, MediaItem_Take *take,
+                        const std::vector<float> &curve, double hopSeconds) {
+    if (!item || !take || curve.empty() || hopSeconds <= 0.0)
+        return false;
+
+    const float peak = *std::max_element(curve.begin(), curve.end());
+    const float scale = peak > 0.f ? 1.f / peak : 0.f;
+    std::vector<float> scaled(curve.size());
+    for (size_t i = 0; i < curve.size(); i++)
+        scaled[i] = std::max(curve[i] * scale, 0.f);
+    const std::vector<size_t> points = DecimateCurve(scaled, kTolerance);
+
+    TrackEnvelope *envelope = GetTakeEnvelopeByName(take, "Volume");
+    if (envelope) {
+        if (!IsOwned(take))
+            return false;
+    } else {
+        envelope = CreateVolumeEnvelope(item, take);
+        if (!envelope)
+            return false;
+        SetOwned(take, true);
+        // Bypassed so that playback is unchanged; the action leaves it active
+        SetEnvelopeStateChunk(envelope,
+                              "<VOLENV\nACT 0 -1\nVIS 1 1 1\nLANEHEIGHT 0 0\n"
+                              "ARM 0\nDEFSHAPE 0 -1 -1\n>\n",
+                              false);
+    }
+
+    const int scalingMode = GetEnvelopeScalingMode(envelope);
+    bool noSort = true;
+    PreventUIRefresh(1);
+    DeleteEnvelopePointRange(envelope, -kEndOfTime, kEndOfTime);
+    for (size_t i : points)
+        InsertEnvelopePoint(envelope, double(i) * hopSeconds,
+                            ScaleToEnvelopeMode(scalingMode, scaled[i]), 0,
+                            0.0, false, &noSort);
+    Envelope_SortPoints(envelope);
+    PreventUIRefresh(-1);
+    return true;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "reaper_plugin.h"
+
+#include <cstddef>
+#include <vector>
+
+// Indices of the values of curve needed to draw it to within tolerance by
+// joining them with straight lines (Douglas-Peucker, measured vertically).
+// The first and last values are always kept.
+std::vector<size_t> DecimateCurve(const std::vector<float> &curve,
+                                  float tolerance);
+
+// Draws curve, one value every hopSeconds from the start of the take, as
+// the take's volume envelope, scaled to 0..1 and bypassed so that playback
+// is unchanged. The envelope is created if the take has none; one created
+// here is redrawn in place on later runs. A volume envelope the user made
+// is left alone and false returned.
+bool ApplyCurveEnvelope(MediaItem *item, MediaItem_Take *take,
+                        const std::vector<float> &curve, double hopSeconds);
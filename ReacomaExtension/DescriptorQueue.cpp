@@ -0,0 +1,117 @@
+#include "DescriptorQueue.h"
+
+#include <algorithm>
+
+namespace {
+
+// Slices a thread claims at a time; small enough to balance slices of very
+// different lengths, large enough that the counter isn't contended
+constexpr int kSlicesPerClaim = 8;
+
+} // namespace
+
+DescriptorQueue::DescriptorQueue(int numThreads)
+    : mNumThreads(std::max(numThreads, 1)), mThread([this] { Run(); }) {}
+
+DescriptorQueue::~DescriptorQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+        mQueue.clear();
+    }
+    mCancelled = true;
+    mWake.notify_all();
+    mThread.join();
+}
+
+void DescriptorQueue::Submit(Request request) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQueue.push_back(std::move(request));
+    }
+    mWake.notify_one();
+}
+
+bool DescriptorQueue::HasCapacity() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mQueue.size() + (mDescribing ? 1 : 0) < kMaxPending;
+}
+
+bool DescriptorQueue::IsIdle() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mQueue.empty() && !mDescribing && mCompleted.empty();
+}
+
+void DescriptorQueue::ProcessCompleted() {
+    std::deque<std::pair<std::function<void(bool)>, bool>> completed;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        completed.swap(mCompleted);
+    }
+    for (auto &[onComplete, ok] : completed) {
+        if (onComplete)
+            onComplete(ok);
+    }
+}
+
+void DescriptorQueue::Run() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mWake.wait(lock, [this] { return mStopping || !mQueue.empty(); });
+        if (mStopping)
+            return;
+
+        Request request = std::move(mQueue.front());
+        mQueue.pop_front();
+        mDescribing = true;
+
+        lock.unlock();
+        const bool ok = Describe(request);
+        lock.lock();
+
+        mCompleted.emplace_back(std::move(request.onComplete), ok);
+        mDescribing = false;
+    }
+}
+
+bool DescriptorQueue::Describe(const Request &request) {
+    const int numSlices = static_cast<int>(request.boundaries.size()) - 1;
+    if (numSlices <= 0 || request.sampleRate <= 0)
+        return false;
+
+    std::vector<SliceDescriptors> descriptors(numSlices);
+    std::atomic<int> nextSlice{0};
+    auto work = [&]() {
+        DescriptorAnalyser analyser(request.sampleRate);
+        while (!mCancelled) {
+            const int first = nextSlice.fetch_add(kSlicesPerClaim);
+            if (first >= numSlices)
+                return;
+            const int last = std::min(numSlices, first + kSlicesPerClaim);
+            for (int i = first; i < last; i++) {
+                const int start = request.boundaries[i];
+                const int end = request.boundaries[i + 1];
+                descriptors[i] =
+                    analyser.Analyse(request.audio.data() + start, end - start);
+                descriptors[i].start =
+                    request.sourceOffset + double(start) / request.sampleRate;
+                descriptors[i].end =
+                    request.sourceOffset + double(end) / request.sampleRate;
+            }
+        }
+    };
+
+    // A take with few slices isn't worth starting threads for
+    const int numThreads = std::min(
+        mNumThreads, (numSlices + kSlicesPerClaim - 1) / kSlicesPerClaim);
+    std::vector<std::thread> pool;
+    for (int t = 1; t < numThreads; t++)
+        pool.emplace_back(work);
+    work();
+    for (auto &thread : pool)
+        thread.join();
+
+    if (mCancelled)
+        return false;
+    return WriteDescriptorFile(request.path, descriptors);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "SliceDescriptors.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Describes the slices of takes in the background and writes each take's
+// descriptors to a file. A request's slices are shared out among a pool of
+// threads in small batches, each thread with an analyser of its own, so a
+// take with thousands of slices keeps every core busy. Completion callbacks
+// run on the main thread from ProcessCompleted().
+class DescriptorQueue {
+public:
+    // Requests carry their audio, so the main thread holds back further
+    // takes while this many are waiting
+    static constexpr size_t kMaxPending = 4;
+
+    struct Request {
+        std::string path;
+        // Mono audio of the take
+        std::vector<float> audio;
+        int sampleRate = 0;
+        // Position of the audio in the source, in seconds
+        double sourceOffset = 0.0;
+        // Slice i runs from boundaries[i] to boundaries[i + 1], in samples
+        // into audio
+        std::vector<int> boundaries;
+        // Called on the main thread with whether the file was written
+        std::function<void(bool)> onComplete;
+    };
+
+    explicit DescriptorQueue(int numThreads);
+    ~DescriptorQueue();
+
+    void Submit(Request request);
+    bool HasCapacity() const;
+    // True once nothing is queued, being described or awaiting completion
+    bool IsIdle() const;
+    void ProcessCompleted();
+
+private:
+    void Run();
+    bool Describe(const Request &request);
+
+    const int mNumThreads;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mWake;
+    std::deque<Request> mQueue;
+    std::deque<std::pair<std::function<void(bool)>, bool>> mCompleted;
+    bool mDescribing = false;
+    bool mStopping = false;
+    // Read by the pool, so a request in progress stops on destruction
+    std::atomic<bool> mCancelled{false};
+
+    std::thread mThread;
+};
@@ -0,0 +1,121 @@
+#include "HPSSSeparation.h"
+
+#include "../dependencies/flucoma-core/include/flucoma/algorithms/public/HPSS.hpp"
+#include "../dependencies/flucoma-core/include/flucoma/algorithms/public/STFT.hpp"
+
+#include <algorithm>
+
+namespace {
+
+// Frames are framed as the client's buffered STFT frames a stream: each
+// ends on a multiple of the hop, the first one hop in, and reads zeros
+// outside the item. These are all the frames that overlap it.
+int GetNumFrames(int numSamples, int window, int hop) {
+    return (numSamples + window - 1) / hop;
+}
+
+int GetFrameStart(int frame, int window, int hop) {
+    return (frame + 1) * hop - window;
+}
+
+} // namespace
+
+std::shared_ptr<HPSSSpectrogram> AnalyseHPSS(const std::vector<float> &audio,
+                                             int numChannels, int numSamples,
+                                             int window, int hop, int fft,
+                                             const HPSSProgress &onProgress) {
+    auto spectrogram = std::make_shared<HPSSSpectrogram>();
+    spectrogram->numFrames = GetNumFrames(numSamples, window, hop);
+    spectrogram->numBins = fft / 2 + 1;
+
+    fluid::algorithm::STFT stft(window, fft, hop);
+    fluid::RealVector frame(window);
+    const int numFrames = spectrogram->numFrames;
+    for (int c = 0; c < numChannels; c++) {
+        const float *channel =
+            audio.data() + static_cast<size_t>(c) * numSamples;
+        fluid::ComplexMatrix bins(numFrames, spectrogram->numBins);
+        for (int f = 0; f < numFrames; f++) {
+            if (f % 64 == 0 &&
+                !onProgress((c + static_cast<double>(f) / numFrames) /
+                            numChannels))
+                return nullptr;
+            const int start = GetFrameStart(f, window, hop);
+            for (int i = 0; i < window; i++) {
+                const int sample = start + i;
+                frame(i) = sample >= 0 && sample < numSamples ? channel[sample]
+                                                              : 0.0;
+            }
+            stft.processFrame(frame, bins.row(f));
+        }
+        spectrogram->channels.push_back(std::move(bins));
+    }
+    return spectrogram;
+}
+
+// Runs one channel of the spectrogram through flucoma's HPSS in classic
+// mode and resynthesises both parts, as the client does: the harmonic
+// filter is centred, so each frame comes out (size - 1) / 2 frames late,
+// and the overlap-added frames are divided by the sum of the analysis and
+// synthesis windows
+bool SeparateHPSS(fluid::ComplexMatrix &bins, int numSamples, int window,
+                  int hop, int fft, int harmFilterSize, int percFilterSize,
+                  fluid::FluidTensorView<float, 1> harmonicOut,
+                  fluid::FluidTensorView<float, 1> percussiveOut,
+                  const HPSSProgress &onProgress) {
+    const int numFrames = static_cast<int>(bins.rows());
+    const int numBins = static_cast<int>(bins.cols());
+    const int delay = (harmFilterSize - 1) / 2;
+
+    fluid::algorithm::HPSS hpss(fft, harmFilterSize);
+    hpss.init(numBins, harmFilterSize);
+    // Only for its window, which normalises the output
+    fluid::algorithm::STFT stft(window, fft, hop);
+    fluid::algorithm::ISTFT istft(window, fft, hop);
+
+    fluid::ComplexVector silence(numBins);
+    fluid::ComplexMatrix parts(3, numBins);
+    fluid::RealVector frame(window);
+    std::vector<double> harmonic(numSamples);
+    std::vector<double> percussive(numSamples);
+    std::vector<double> norm(numSamples);
+
+    auto overlapAdd = [&](int start, std::vector<double> &out) {
+        for (int i = std::max(0, -start);
+             i < window && start + i < numSamples; i++)
+            out[start + i] += frame(i);
+    };
+
+    for (int f = 0; f < numFrames + delay; f++) {
+        if (f % 64 == 0 &&
+            !onProgress(static_cast<double>(f) / (numFrames + delay)))
+            return false;
+        fluid::ComplexVectorView in =
+            f < numFrames ? bins.row(f) : fluid::ComplexVectorView(silence);
+        // Classic mode, with the client's default thresholds, which it
+        // doesn't read
+        hpss.processFrame(in, parts.transpose(), percFilterSize, harmFilterSize,
+                          0, 0, 1, 1, 1, 1, 0, 1, 1);
+        if (f < delay)
+            continue;
+
+        const int start = GetFrameStart(f - delay, window, hop);
+        istft.processFrame(parts.row(0), frame);
+        overlapAdd(start, harmonic);
+        istft.processFrame(parts.row(1), frame);
+        overlapAdd(start, percussive);
+    }
+
+    for (int f = 0; f < numFrames; f++) {
+        const int start = GetFrameStart(f, window, hop);
+        for (int i = std::max(0, -start);
+             i < window && start + i < numSamples; i++)
+            norm[start + i] += stft.window()(i) * istft.window()(i);
+    }
+    for (int i = 0; i < numSamples; i++) {
+        const double scale = norm[i] > 0.0 ? 1.0 / norm[i] : 0.0;
+        harmonicOut(i) = static_cast<float>(harmonic[i] * scale);
+        percussiveOut(i) = static_cast<float>(percussive[i] * scale);
+    }
+    return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "../dependencies/flucoma-core/include/flucoma/data/TensorTypes.hpp"
+
+#include <complex>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Harmonic percussive separation with flucoma's STFT, HPSS and ISTFT, framed
+// as NRTThreadedHPSSClient frames a stream, in two stages so that the
+// spectrogram can be kept while only the filter sizes change.
+
+// Complex spectrogram of every channel of an item, frames by bins
+struct HPSSSpectrogram {
+    int numFrames = 0;
+    int numBins = 0;
+    std::vector<fluid::ComplexMatrix> channels;
+
+    size_t GetBytes() const {
+        return channels.size() * static_cast<size_t>(numFrames) * numBins *
+               sizeof(std::complex<double>);
+    }
+};
+
+// Called with the fraction of a stage done; returning false abandons it
+using HPSSProgress = std::function<bool(double)>;
+
+// Spectrogram of numChannels channels of numSamples each, stored one after
+// the other in audio, or null if abandoned
+std::shared_ptr<HPSSSpectrogram> AnalyseHPSS(const std::vector<float> &audio,
+                                             int numChannels, int numSamples,
+                                             int window, int hop, int fft,
+                                             const HPSSProgress &onProgress);
+
+// Separates one channel of a spectrogram into numSamples of each part
+bool SeparateHPSS(fluid::ComplexMatrix &bins, int numSamples, int window,
+                  int hop, int fft, int harmFilterSize, int percFilterSize,
+                  fluid::FluidTensorView<float, 1> harmonicOut,
+                  fluid::FluidTensorView<float, 1> percussiveOut,
+                  const HPSSProgress &onProgress);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+// Incremental 64-bit FNV-1a hash. Used to build cache keys from item state,
+// audio content and parameter values.
+class Hasher {
+public:
+    void Add(const void *data, size_t size) {
+        const auto *bytes = static_cast<const unsigned char *>(data);
+        for (size_t i = 0; i < size; ++i) {
+            mState ^= bytes[i];
+            mState *= kPrime;
+        }
+    }
+
+    template <typename T> void AddValue(const T &value) {
+        static_assert(std::is_trivially_copyable<T>::value,
+                      "Only plain values can be hashed by their bytes");
+        Add(&value, sizeof(T));
+    }
+
+    void AddString(const std::string &str) {
+        AddValue(str.size());
+        Add(str.data(), str.size());
+    }
+
+    uint64_t Get() const { return mState; }
+
+private:
+    static constexpr uint64_t kOffsetBasis = 14695981039346656037ull;
+    static constexpr uint64_t kPrime = 1099511628211ull;
+
+    uint64_t mState = kOffsetBasis;
+};
@@ -0,0 +1,82 @@
+#include "ItemOverrides.h"
+
+#include "wdltypes.h"
+#include "reaper_plugin_functions.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+// Entries are "name=value" separated by ';', e.g. "Threshold=0.3;Kernel
+// Size=5"; names can't contain either character
+
+namespace {
+
+std::string GetKey(const std::string &algorithmKey) {
+    std::string key = "P_EXT:reacoma_params:" + algorithmKey;
+    std::replace(key.begin(), key.end(), ' ', '_');
+    return key;
+}
+
+} // namespace
+
+std::string ReadItemOverrides(MediaItem_Take *take,
+                              const std::string &algorithmKey) {
+    char buffer[4096] = "";
+    if (!take || !GetSetMediaItemTakeInfo_String(
+                     take, GetKey(algorithmKey).c_str(), buffer, false))
+        return "";
+    buffer[sizeof(buffer) - 1] = '\0';
+    return buffer;
+}
+
+bool ApplyItemOverrides(MediaItem_Take *take, const std::string &algorithmKey,
+                        const std::vector<std::string> &paramNames,
+                        std::vector<double> &values) {
+    const std::string overrides = ReadItemOverrides(take, algorithmKey);
+    bool applied = false;
+    size_t start = 0;
+    while (start < overrides.size()) {
+        size_t end = overrides.find(';', start);
+        if (end == std::string::npos)
+            end = overrides.size();
+        const size_t equals = overrides.find('=', start);
+        if (equals < end) {
+            const std::string name = overrides.substr(start, equals - start);
+            const std::string value =
+                overrides.substr(equals + 1, end - equals - 1);
+            char *parsedEnd = nullptr;
+            const double parsed = std::strtod(value.c_str(), &parsedEnd);
+            auto param = std::find(paramNames.begin(), paramNames.end(), name);
+            if (param != paramNames.end() && parsedEnd != value.c_str() &&
+                static_cast<size_t>(param - paramNames.begin()) <
+                    values.size()) {
+                values[param - paramNames.begin()] = parsed;
+                applied = true;
+            }
+        }
+        start = end + 1;
+    }
+    return applied;
+}
+
+void StoreItemOverrides(MediaItem_Take *take, const std::string &algorithmKey,
+                        const std::vector<std::string> &paramNames,
+                        const std::vector<double> &values) {
+    std::string overrides;
+    char value[64];
+    for (size_t i = 0; i < paramNames.size() && i < values.size(); i++) {
+        if (!overrides.empty())
+            overrides += ';';
+        snprintf(value, sizeof(value), "%.15g", values[i]);
+        overrides += paramNames[i] + "=" + value;
+    }
+    GetSetMediaItemTakeInfo_String(take, GetKey(algorithmKey).c_str(),
+                                   &overrides[0], true);
+}
+
+void ClearItemOverrides(MediaItem_Take *take, const std::string &algorithmKey) {
+    char empty[1] = "";
+    GetSetMediaItemTakeInfo_String(take, GetKey(algorithmKey).c_str(), empty,
+                                   true);
+}
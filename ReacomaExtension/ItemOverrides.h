@@ -0,0 +1,25 @@
+#pragma once
+
+#include "reaper_plugin.h"
+
+#include <string>
+#include <vector>
+
+// Parameter values set on a single item, which take the place of the global
+// values whenever the item is processed. They are kept per algorithm in the
+// extension state of the take the item is processed from, by parameter
+// name, so they are saved with the project and follow the take through
+// undo. algorithmKey is ReacomaExtension::GetAlgorithmKey().
+
+// Replaces the entries of values that the take overrides; false if it
+// overrides none of them
+bool ApplyItemOverrides(MediaItem_Take *take, const std::string &algorithmKey,
+                        const std::vector<std::string> &paramNames,
+                        std::vector<double> &values);
+// The take's overrides as stored, for hashing; empty if there are none
+std::string ReadItemOverrides(MediaItem_Take *take,
+                              const std::string &algorithmKey);
+void StoreItemOverrides(MediaItem_Take *take, const std::string &algorithmKey,
+                        const std::vector<std::string> &paramNames,
+                        const std::vector<double> &values);
+void ClearItemOverrides(MediaItem_Take *take, const std::string &algorithmKey);
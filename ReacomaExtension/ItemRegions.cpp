@@ -0,0 +1,130 @@
+#include "ItemRegions.h"
+
+#include "wdltypes.h"
+#include "reaper_plugin_functions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+constexpr const char *kOwnedKey = "P_EXT:reacoma_regions";
+constexpr size_t kMaxOwnedLength = 65536;
+constexpr double kTolerance = 1e-9;
+
+struct OwnedRegion {
+    int number;
+    ItemRegion region;
+};
+
+// Region numbers are stored as ranges, e.g. "3-40 52", since the regions of
+// one run are usually numbered consecutively
+std::vector<int> ReadOwned(MediaItem *item) {
+    std::vector<char> buffer(kMaxOwnedLength, '\0');
+    std::vector<int> numbers;
+    if (!GetSetMediaItemInfo_String(item, kOwnedKey, buffer.data(), false))
+        return numbers;
+    buffer.back() = '\0';
+
+    const char *p = buffer.data();
+    while (*p) {
+        char *end;
+        const long first = std::strtol(p, &end, 10);
+        if (end == p)
+            break;
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = std::strtol(p + 1, &end, 10);
+            p = end;
+        }
+        if (first < 0 || last - first > static_cast<long>(kMaxOwnedLength))
+            break;
+        for (long n = first; n <= last; n++)
+            numbers.push_back(static_cast<int>(n));
+        while (*p == ' ')
+            p++;
+    }
+    std::sort(numbers.begin(), numbers.end());
+    return numbers;
+}
+
+void WriteOwned(MediaItem *item, const std::vector<int> &numbers) {
+    std::string value;
+    for (size_t i = 0; i < numbers.size();) {
+        size_t j = i;
+        while (j + 1 < numbers.size() && numbers[j + 1] == numbers[j] + 1)
+            j++;
+        if (!value.empty())
+            value += ' ';
+        value += std::to_string(numbers[i]);
+        if (j > i)
+            value += '-' + std::to_string(numbers[j]);
+        i = j + 1;
+    }
+    GetSetMediaItemInfo_String(item, kOwnedKey, &value[0], true);
+}
+
+bool Differs(const ItemRegion &a, const ItemRegion &b) {
+    return std::fabs(a.start - b.start) > kTolerance ||
+           std::fabs(a.end - b.end) > kTolerance || a.name != b.name;
+}
+
+} // namespace
+
+void ApplyItemRegions(MediaItem *item, const std::vector<ItemRegion> &regions) {
+    ReaProject *project = GetItemProjectContext(item);
+    if (!project)
+        return;
+
+    const std::vector<int> owned = ReadOwned(item);
+
+    // Owned regions that still exist, in project order
+    std::vector<OwnedRegion> existing;
+    if (!owned.empty()) {
+        bool isRegion = false;
+        double start = 0.0;
+        double end = 0.0;
+        const char *name = nullptr;
+        int number = 0;
+        for (int i = 0; EnumProjectMarkers3(project, i, &isRegion, &start,
+                                            &end, &name, &number, nullptr);
+             i++) {
+            if (isRegion &&
+                std::binary_search(owned.begin(), owned.end(), number))
+                existing.push_back({number, {start, end, name ? name : ""}});
+        }
+    }
+
+    std::vector<int> numbers;
+    numbers.reserve(regions.size());
+    const size_t numReused = std::min(existing.size(), regions.size());
+
+    PreventUIRefresh(1);
+    // Region names count up from the start of the item, so pairing regions
+    // by order already leaves unchanged whatever can stay unchanged
+    for (size_t i = 0; i < numReused; i++) {
+        const OwnedRegion &current = existing[i];
+        const ItemRegion &region = regions[i];
+        if (Differs(current.region, region))
+            SetProjectMarker4(project, current.number, true, region.start,
+                              region.end, region.name.c_str(), 0, 0);
+        numbers.push_back(current.number);
+    }
+    for (size_t i = numReused; i < existing.size(); i++)
+        DeleteProjectMarker(project, existing[i].number, true);
+    for (size_t i = numReused; i < regions.size(); i++) {
+        const ItemRegion &region = regions[i];
+        const int number = AddProjectMarker2(project, true, region.start,
+                                             region.end, region.name.c_str(),
+                                             -1, 0);
+        if (number >= 0)
+            numbers.push_back(number);
+    }
+    PreventUIRefresh(-1);
+
+    std::sort(numbers.begin(), numbers.end());
+    if (numbers != owned)
+        WriteOwned(item, numbers);
+}
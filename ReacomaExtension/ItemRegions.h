@@ -0,0 +1,21 @@
+#pragma once
+
+#include "reaper_plugin.h"
+
+#include <string>
+#include <vector>
+
+struct ItemRegion {
+    // Project time in seconds
+    double start = 0.0;
+    double end = 0.0;
+    std::string name;
+};
+
+// Makes the regions Reacoma owns for item match regions, in order. The
+// numbers of the owned regions are kept in the item's extension state, so a
+// rerun updates the regions of the previous run in place rather than adding
+// more, and a rerun with the same result changes nothing. Regions the user
+// deleted are forgotten; regions not created here are never touched. All
+// changes are made with UI refreshes suspended.
+void ApplyItemRegions(MediaItem *item, const std::vector<ItemRegion> &regions);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdio>
+#include <filesystem>
+
+#ifdef _WIN32
+#include <string>
+#endif
+
+// fopen() for a path made with std::filesystem::u8path(). Windows' fopen()
+// reads the name in the ANSI code page, so a UTF-8 name only opens there
+// through the wide path.
+inline FILE *OpenFile(const std::filesystem::path &path, const char *mode) {
+#ifdef _WIN32
+    const std::wstring wideMode(mode,
+                                mode + std::char_traits<char>::length(mode));
+    return _wfopen(path.c_str(), wideMode.c_str());
+#else
+    return fopen(path.c_str(), mode);
+#endif
+}
@@ -0,0 +1,66 @@
+#include "OutputFormat.h"
+
+#include <cstring>
+
+namespace {
+
+void AppendFourCC(std::vector<char> &config, const char *fourcc) {
+    config.insert(config.end(), fourcc, fourcc + 4);
+}
+
+void AppendInt(std::vector<char> &config, int value) {
+    char bytes[sizeof(int)];
+    memcpy(bytes, &value, sizeof(int));
+    config.insert(config.end(), bytes, bytes + sizeof(int));
+}
+
+} // namespace
+
+std::vector<char> GetSinkConfig(EOutputFormat format) {
+    std::vector<char> config;
+    switch (format) {
+        case kOutputFLAC:
+            // Bit depth, then compression level (0-8)
+            AppendFourCC(config, "calf");
+            AppendInt(config, GetOutputBitDepth(format));
+            AppendInt(config, 5);
+            break;
+        case kOutputWavPack:
+            // Mode (0 = normal), then bit depth (1 = 24-bit)
+            AppendFourCC(config, "kpvw");
+            AppendInt(config, 0);
+            AppendInt(config, 1);
+            break;
+        default:
+            AppendFourCC(config, "evaw");
+            AppendInt(config, format == kOutputFloat32
+                                  ? 32
+                                  : GetOutputBitDepth(format));
+            break;
+    }
+    return config;
+}
+
+const char *GetOutputExtension(EOutputFormat format) {
+    switch (format) {
+        case kOutputFLAC:
+            return ".flac";
+        case kOutputWavPack:
+            return ".wv";
+        default:
+            return ".wav";
+    }
+}
+
+int GetOutputBitDepth(EOutputFormat format) {
+    switch (format) {
+        case kOutputPCM16:
+            return 16;
+        case kOutputPCM24:
+        case kOutputFLAC:
+        case kOutputWavPack:
+            return 24;
+        default:
+            return 0;
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+
+// File formats rendered outputs can be written in, in the order of the
+// output format parameter's labels
+enum EOutputFormat {
+    kOutputFloat32 = 0,
+    kOutputPCM24,
+    kOutputPCM16,
+    kOutputFLAC,
+    kOutputWavPack,
+    kNumOutputFormats
+};
+
+// Configuration block to pass to PCM_Sink_CreateEx
+std::vector<char> GetSinkConfig(EOutputFormat format);
+const char *GetOutputExtension(EOutputFormat format);
+// Integer bit depth the format stores, or 0 for floating point
+int GetOutputBitDepth(EOutputFormat format);
@@ -0,0 +1,131 @@
+#include "OutputQueue.h"
+#include "Hasher.h"
+#include "OutputStore.h"
+
+#include "wdltypes.h"
+#include "reaper_plugin_functions.h"
+
+#include <filesystem>
+
+OutputQueue::OutputQueue(OutputStore &store)
+    : mStore(store), mThread([this] { Run(); }) {}
+
+OutputQueue::~OutputQueue() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+        mQueue.clear();
+    }
+    mWake.notify_all();
+    mThread.join();
+}
+
+void OutputQueue::Submit(Request request) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQueue.push_back(std::move(request));
+    }
+    mWake.notify_one();
+}
+
+bool OutputQueue::HasCapacity() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mQueue.size() + (mWriting ? 1 : 0) < kMaxPending;
+}
+
+bool OutputQueue::IsIdle() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mQueue.empty() && !mWriting && mCompleted.empty();
+}
+
+void OutputQueue::CancelPending() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (auto &request : mQueue)
+        mCompleted.push_back(
+            {std::move(request.onComplete), std::move(request.path), false});
+    mQueue.clear();
+}
+
+void OutputQueue::ProcessCompleted() {
+    std::deque<Completion> completed;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        completed.swap(mCompleted);
+    }
+    for (auto &completion : completed) {
+        mStore.Release(completion.path);
+        if (completion.onComplete)
+            completion.onComplete(completion.ok);
+    }
+}
+
+void OutputQueue::Run() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mWake.wait(lock, [this] { return mStopping || !mQueue.empty(); });
+        if (mStopping)
+            return;
+
+        Request request = std::move(mQueue.front());
+        mQueue.pop_front();
+        mWriting = true;
+
+        lock.unlock();
+        const bool ok = Render(request);
+        // Release the rendered audio before the main thread gets round to
+        // the completion
+        request.render = nullptr;
+        lock.lock();
+
+        mCompleted.push_back(
+            {std::move(request.onComplete), std::move(request.path), ok});
+        mWriting = false;
+    }
+}
+
+bool OutputQueue::Render(Request &request) {
+    // Zero means the content could not be hashed
+    uint64_t contentKey = 0;
+    const uint64_t contentHash =
+        request.hashContent ? request.hashContent() : 0;
+    if (contentHash != 0) {
+        Hasher hasher;
+        hasher.AddValue(contentHash);
+        hasher.AddValue(request.numChans);
+        hasher.AddValue(request.sampleRate);
+        hasher.AddValue(request.format);
+        contentKey = hasher.Get();
+        if (mStore.LinkDuplicate(contentKey, request.path))
+            return true;
+    }
+
+    const auto path = std::filesystem::u8path(request.path);
+    auto tempPath = path;
+    tempPath += ".tmp";
+
+    const std::vector<char> config = GetSinkConfig(request.format);
+    PCM_sink *sink = PCM_Sink_CreateEx(
+        nullptr, tempPath.u8string().c_str(), config.data(),
+        static_cast<int>(config.size()), request.numChans,
+        request.sampleRate, true);
+    if (!sink)
+        return false;
+    mWriter.SetBitDepth(GetOutputBitDepth(request.format));
+    const bool rendered = request.render(mWriter, sink);
+    delete sink;
+
+    std::error_code ec;
+    if (rendered)
+        std::filesystem::rename(tempPath, path, ec);
+    if (!rendered || ec) {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+
+    const auto size = std::filesystem::file_size(path, ec);
+    if (!ec)
+        mBytesWritten += size;
+    if (contentKey != 0)
+        mStore.AddContent(contentKey, request.path);
+    return true;
+}
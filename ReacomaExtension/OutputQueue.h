@@ -0,0 +1,81 @@
+#pragma once
+
+#include "OutputFormat.h"
+#include "OutputWriter.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class OutputStore;
+
+// Renders output files on a background thread so that large writes don't
+// block REAPER. Each request is written to a temporary file next to its
+// destination and renamed into place once complete; its completion callback
+// then runs on the main thread from ProcessCompleted(), which is where takes
+// are created. Paths should be reserved from the OutputStore, which the
+// queue releases on completion.
+class OutputQueue {
+public:
+    // Finalisation holds back further results while this many files are
+    // waiting to be written, which bounds the memory held by the queue
+    static constexpr size_t kMaxPending = 4;
+
+    struct Request {
+        std::string path;
+        int numChans = 0;
+        int sampleRate = 0;
+        EOutputFormat format = kOutputFloat32;
+        // Streams the audio into the sink; called on the writer thread
+        std::function<bool(OutputWriter &, PCM_sink *)> render;
+        // Optional hash of the audio render() would write, letting a repeat
+        // of an earlier render link to its file; called on the writer thread
+        std::function<uint64_t()> hashContent;
+        // Called on the main thread with whether the file was written
+        std::function<void(bool)> onComplete;
+    };
+
+    explicit OutputQueue(OutputStore &store);
+    ~OutputQueue();
+
+    void Submit(Request request);
+    bool HasCapacity() const;
+    // True once nothing is queued, being written or awaiting completion
+    bool IsIdle() const;
+    // Drops requests that haven't started; their callbacks report failure
+    void CancelPending();
+    void ProcessCompleted();
+
+    // Size of the files completed since the last reset
+    uint64_t GetBytesWritten() const { return mBytesWritten; }
+    void ResetBytesWritten() { mBytesWritten = 0; }
+
+private:
+    struct Completion {
+        std::function<void(bool)> onComplete;
+        std::string path;
+        bool ok;
+    };
+
+    void Run();
+    bool Render(Request &request);
+
+    mutable std::mutex mMutex;
+    std::condition_variable mWake;
+    std::deque<Request> mQueue;
+    std::deque<Completion> mCompleted;
+    bool mWriting = false;
+    bool mStopping = false;
+    std::atomic<uint64_t> mBytesWritten{0};
+
+    OutputStore &mStore;
+
+    OutputWriter mWriter;
+    std::thread mThread;
+};
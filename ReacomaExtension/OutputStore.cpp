@@ -0,0 +1,124 @@
+#include "OutputStore.h"
+
+#include <filesystem>
+#include <set>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr const char *kFolderName = "reacoma";
+
+fs::path Normalise(const fs::path &path) {
+    std::error_code ec;
+    fs::path normalised = fs::weakly_canonical(path, ec);
+    return ec ? path.lexically_normal() : normalised;
+}
+
+bool IsRenderedFile(const fs::path &path) {
+    const std::string extension = path.extension().u8string();
+    return extension == ".wav" || extension == ".flac" ||
+           extension == ".wv" || extension == ".tmp";
+}
+
+} // namespace
+
+std::string OutputStore::Reserve(const std::string &folder,
+                                 const std::string &baseName,
+                                 const std::string &extension) {
+    const fs::path folderPath = fs::u8path(folder);
+    std::error_code ec;
+    for (int attempt = 1;; attempt++) {
+        std::string name = baseName;
+        if (attempt > 1)
+            name += "-" + std::to_string(attempt);
+        const std::string path = (folderPath / fs::u8path(name + extension))
+                                     .u8string();
+        if (mReserved.count(path) || fs::exists(fs::u8path(path), ec))
+            continue;
+        mReserved.insert(path);
+        return path;
+    }
+}
+
+void OutputStore::Release(const std::string &path) { mReserved.erase(path); }
+
+bool OutputStore::LinkDuplicate(uint64_t contentKey, const std::string &path) {
+    std::string existing;
+    {
+        std::lock_guard<std::mutex> lock(mContentMutex);
+        auto it = mContent.find(contentKey);
+        if (it == mContent.end())
+            return false;
+        existing = it->second;
+    }
+
+    // Fails across volumes, or if the earlier file has been deleted, in
+    // which case the output is simply rendered again
+    std::error_code ec;
+    fs::create_hard_link(fs::u8path(existing), fs::u8path(path), ec);
+    return !ec;
+}
+
+void OutputStore::AddContent(uint64_t contentKey, const std::string &path) {
+    std::lock_guard<std::mutex> lock(mContentMutex);
+    mContent[contentKey] = path;
+}
+
+std::vector<std::string>
+OutputStore::FindGarbage(const std::vector<std::string> &referencedFiles,
+                         GarbageReport &report) {
+    std::set<fs::path> referenced;
+    std::set<fs::path> folders;
+    for (const auto &file : referencedFiles) {
+        const fs::path path = Normalise(fs::u8path(file));
+        referenced.insert(path);
+        const fs::path parent = path.parent_path();
+        folders.insert(parent.filename() == kFolderName ? parent
+                                                        : parent / kFolderName);
+    }
+
+    report = {};
+    std::vector<std::string> garbage;
+    std::error_code ec;
+    for (const auto &folder : folders) {
+        for (fs::directory_iterator it(folder, ec), end; !ec && it != end;
+             it.increment(ec)) {
+            if (!it->is_regular_file(ec) || !IsRenderedFile(it->path()))
+                continue;
+            const fs::path path = Normalise(it->path());
+            if (referenced.count(path))
+                continue;
+
+            garbage.push_back(path.u8string());
+            report.numFiles++;
+            report.numBytes += it->file_size(ec);
+
+            // Peaks REAPER built next to the file go with it
+            fs::path peaks = path;
+            peaks += ".reapeaks";
+            if (fs::exists(peaks, ec)) {
+                garbage.push_back(peaks.u8string());
+                report.numBytes += fs::file_size(peaks, ec);
+            }
+        }
+        ec.clear();
+    }
+    return garbage;
+}
+
+OutputStore::GarbageReport
+OutputStore::DeleteFiles(const std::vector<std::string> &paths) {
+    GarbageReport report;
+    for (const auto &path : paths) {
+        std::error_code ec;
+        const fs::path file = fs::u8path(path);
+        const auto size = fs::file_size(file, ec);
+        if (!ec && fs::remove(file, ec) && !ec) {
+            report.numBytes += size;
+            if (file.extension() != ".reapeaks")
+                report.numFiles++;
+        }
+    }
+    return report;
+}
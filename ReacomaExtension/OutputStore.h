@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Owns the names and contents of rendered files in the reacoma folders.
+// Names are handed out unique, both against files on disk and against
+// files still being written, so outputs started within the same second
+// never collide. Renders are identified by a hash of their content; a
+// repeat of an earlier render becomes a hard link to its file instead of a
+// second copy. Unreferenced files can be collected once no render is in
+// flight.
+class OutputStore {
+public:
+    struct GarbageReport {
+        size_t numFiles = 0;
+        uint64_t numBytes = 0;
+    };
+
+    // Path for a new file named baseName + extension in folder, with -2,
+    // -3, ... appended to baseName while that name is taken. Main thread.
+    std::string Reserve(const std::string &folder, const std::string &baseName,
+                        const std::string &extension);
+    // Called once the reserved file has been written or abandoned
+    void Release(const std::string &path);
+
+    // Makes path a hard link to an earlier render with the same content
+    // key, if one still exists on the same volume. Writer thread.
+    bool LinkDuplicate(uint64_t contentKey, const std::string &path);
+    void AddContent(uint64_t contentKey, const std::string &path);
+
+    // Rendered files in the reacoma folders next to the given sources and
+    // outputs that are not among them. Only rendered formats and leftover
+    // temporary files are considered.
+    static std::vector<std::string>
+    FindGarbage(const std::vector<std::string> &referencedFiles,
+                GarbageReport &report);
+    static GarbageReport DeleteFiles(const std::vector<std::string> &paths);
+
+private:
+    std::unordered_set<std::string> mReserved;
+
+    std::mutex mContentMutex;
+    std::unordered_map<uint64_t, std::string> mContent;
+};
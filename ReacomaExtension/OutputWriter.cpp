@@ -0,0 +1,62 @@
+#include "OutputWriter.h"
+#include "SampleConversion.h"
+
+#include <algorithm>
+#include <cmath>
+
+void OutputWriter::Write(PCM_sink *sink, const float *interleaved,
+                         int numFrames, int numChans) {
+    std::vector<int> channelMap(std::max(numChans, 0));
+    for (int c = 0; c < numChans; c++)
+        channelMap[c] = c;
+    Write(sink, interleaved, numFrames, numChans, channelMap);
+}
+
+void OutputWriter::Write(PCM_sink *sink, const float *interleaved,
+                         int numFrames, int numChans,
+                         const std::vector<int> &channelMap) {
+    if (!sink || !interleaved || numFrames <= 0 || numChans <= 0 ||
+        channelMap.empty())
+        return;
+    for (int channel : channelMap) {
+        if (channel < 0 || channel >= numChans)
+            return;
+    }
+
+    const int numOutputChans = static_cast<int>(channelMap.size());
+    mScratch.resize(static_cast<size_t>(kBlockFrames) * numChans);
+    mChannels.resize(numOutputChans);
+    for (int c = 0; c < numOutputChans; c++)
+        mChannels[c] = mScratch.data() + channelMap[c];
+
+    for (int start = 0; start < numFrames; start += kBlockFrames) {
+        const int length = std::min(kBlockFrames, numFrames - start);
+        const size_t count = static_cast<size_t>(length) * numChans;
+        ConvertFloatToDouble(interleaved +
+                                 static_cast<size_t>(start) * numChans,
+                             mScratch.data(), count);
+        if (mBitDepth > 0)
+            Dither(mScratch.data(), count);
+        sink->WriteDoubles(mChannels.data(), length, numOutputChans, 0,
+                           numChans);
+    }
+}
+
+void OutputWriter::Dither(ReaSample *samples, size_t count) {
+    const double scale = std::ldexp(1.0, mBitDepth - 1);
+    const double maxValue = scale - 1.0;
+    auto uniform = [this]() {
+        mNoiseState ^= mNoiseState << 13;
+        mNoiseState ^= mNoiseState >> 17;
+        mNoiseState ^= mNoiseState << 5;
+        return mNoiseState * (1.0 / 4294967296.0);
+    };
+
+    // Sum of two uniform variables: triangular noise of +/-1 LSB
+    for (size_t i = 0; i < count; i++) {
+        const double noise = uniform() + uniform() - 1.0;
+        double value = std::floor(samples[i] * scale + noise + 0.5);
+        value = std::min(maxValue, std::max(-scale, value));
+        samples[i] = value / scale;
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "reaper_plugin.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Streams interleaved float audio into a sink in fixed-size blocks. Samples
+// are widened into a small scratch block and handed to the sink in place,
+// using WriteDoubles' spacing instead of deinterleaving, so memory use does
+// not grow with the length or channel count of the output.
+class OutputWriter {
+public:
+    static constexpr int kBlockFrames = 4096;
+
+    // Integer bit depth the sink stores. Samples are then quantised here
+    // with TPDF dither rather than truncated by the sink; 0 leaves them
+    // untouched for floating-point formats.
+    void SetBitDepth(int bitDepth) { mBitDepth = bitDepth; }
+
+    void Write(PCM_sink *sink, const float *interleaved, int numFrames,
+               int numChans);
+    // Writes only the input channels listed in channelMap, in that order.
+    // Reordering costs nothing extra: each output channel simply points at
+    // its input channel in the converted block.
+    void Write(PCM_sink *sink, const float *interleaved, int numFrames,
+               int numChans, const std::vector<int> &channelMap);
+
+private:
+    void Dither(ReaSample *samples, size_t count);
+
+    int mBitDepth = 0;
+    uint32_t mNoiseState = 0x9e3779b9u;
+    std::vector<ReaSample> mScratch;
+    std::vector<ReaSample *> mChannels;
+};
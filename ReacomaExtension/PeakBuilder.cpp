@@ -0,0 +1,44 @@
+#include "PeakBuilder.h"
+
+#include "wdltypes.h"
+#include "reaper_plugin_functions.h"
+
+void PeakBuilder::Add(MediaItem_Take *take) {
+    PCM_source *source = take ? GetMediaItemTake_Source(take) : nullptr;
+    if (source)
+        mPending.push_back({take, source, false});
+}
+
+bool PeakBuilder::Process(std::chrono::milliseconds budget) {
+    const auto deadline = std::chrono::steady_clock::now() + budget;
+    bool completed = false;
+
+    while (!mPending.empty() && std::chrono::steady_clock::now() < deadline) {
+        Entry &entry = mPending.front();
+        if (!IsCurrent(entry)) {
+            mPending.pop_front();
+            continue;
+        }
+
+        // Mode 0 begins a build and returns zero if the peaks already exist,
+        // mode 1 continues it and returns what remains, mode 2 finishes it
+        if (!entry.started) {
+            if (PCM_Source_BuildPeaks(entry.source, 0) == 0) {
+                mPending.pop_front();
+                continue;
+            }
+            entry.started = true;
+        }
+        if (PCM_Source_BuildPeaks(entry.source, 1) == 0) {
+            PCM_Source_BuildPeaks(entry.source, 2);
+            mPending.pop_front();
+            completed = true;
+        }
+    }
+    return completed;
+}
+
+bool PeakBuilder::IsCurrent(const Entry &entry) {
+    return ValidatePtr2(nullptr, entry.take, "MediaItem_Take*") &&
+           GetMediaItemTake_Source(entry.take) == entry.source;
+}
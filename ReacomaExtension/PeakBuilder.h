@@ -0,0 +1,31 @@
+#pragma once
+
+#include "reaper_plugin.h"
+
+#include <chrono>
+#include <deque>
+
+// Builds the peaks of newly created takes a slice at a time from idle
+// callbacks, so REAPER doesn't build them all at once on the main thread
+// when the takes are first drawn. Only used from the main thread.
+class PeakBuilder {
+public:
+    void Add(MediaItem_Take *take);
+
+    // Builds peaks until budget has elapsed; returns true if any take's
+    // peaks were completed and the arrange view should be redrawn
+    bool Process(std::chrono::milliseconds budget);
+    bool IsIdle() const { return mPending.empty(); }
+
+private:
+    struct Entry {
+        MediaItem_Take *take;
+        PCM_source *source;
+        bool started;
+    };
+
+    // False once the take is deleted or no longer reads the source
+    static bool IsCurrent(const Entry &entry);
+
+    std::deque<Entry> mPending;
+};
@@ -0,0 +1,225 @@
+#include "PresetBank.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+constexpr uint32_t kMagic = 0x52435042; // "RCPB"
+
+class BankWriter {
+public:
+    template <typename T> void Write(const T &value) {
+        mData.append(reinterpret_cast<const char *>(&value), sizeof(T));
+    }
+
+    void WriteString(const std::string &str) {
+        Write<uint32_t>(static_cast<uint32_t>(str.size()));
+        mData += str;
+    }
+
+    std::string Take() { return std::move(mData); }
+
+private:
+    std::string mData;
+};
+
+class BankReader {
+public:
+    explicit BankReader(const std::string &data) : mData(data) {}
+
+    template <typename T> bool Read(T &value) {
+        if (!mOk || mData.size() - mPosition < sizeof(T))
+            return mOk = false;
+        std::memcpy(&value, mData.data() + mPosition, sizeof(T));
+        mPosition += sizeof(T);
+        return true;
+    }
+
+    bool ReadString(std::string &str) {
+        uint32_t length = 0;
+        if (!Read(length) || mData.size() - mPosition < length)
+            return mOk = false;
+        str.assign(mData, mPosition, length);
+        mPosition += length;
+        return true;
+    }
+
+    // Guards counts against a truncated or corrupt file
+    bool ReadCount(uint32_t &count, size_t minItemSize) {
+        if (!Read(count))
+            return false;
+        if (count > (mData.size() - mPosition) / minItemSize)
+            return mOk = false;
+        return true;
+    }
+
+private:
+    const std::string &mData;
+    size_t mPosition = 0;
+    bool mOk = true;
+};
+
+} // namespace
+
+bool PresetBank::Load(const std::string &path) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    std::string data;
+    char buffer[65536];
+    size_t numRead;
+    while ((numRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.append(buffer, numRead);
+    fclose(file);
+
+    BankReader reader(data);
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    uint32_t numAlgorithms = 0;
+    if (!reader.Read(magic) || magic != kMagic || !reader.Read(version) ||
+        version != kVersion || !reader.ReadCount(numAlgorithms, 12))
+        return false;
+
+    std::map<std::string, AlgorithmPresets> algorithms;
+    for (uint32_t a = 0; a < numAlgorithms; a++) {
+        std::string algorithm;
+        uint32_t numParams = 0;
+        if (!reader.ReadString(algorithm) || !reader.ReadCount(numParams, 4))
+            return false;
+        AlgorithmPresets &presets = algorithms[algorithm];
+        presets.paramNames.resize(numParams);
+        for (auto &paramName : presets.paramNames) {
+            if (!reader.ReadString(paramName))
+                return false;
+        }
+
+        uint32_t numPresets = 0;
+        if (!reader.ReadCount(numPresets, 4))
+            return false;
+        presets.presets.resize(numPresets);
+        for (auto &preset : presets.presets) {
+            if (!reader.ReadString(preset.name))
+                return false;
+            preset.values.resize(numParams);
+            for (double &value : preset.values) {
+                if (!reader.Read(value))
+                    return false;
+            }
+        }
+    }
+
+    mAlgorithms = std::move(algorithms);
+    return true;
+}
+
+std::string PresetBank::Serialise() const {
+    BankWriter writer;
+    writer.Write(kMagic);
+    writer.Write(kVersion);
+    writer.Write<uint32_t>(static_cast<uint32_t>(mAlgorithms.size()));
+    for (const auto &entry : mAlgorithms) {
+        const AlgorithmPresets &presets = entry.second;
+        writer.WriteString(entry.first);
+        writer.Write<uint32_t>(
+            static_cast<uint32_t>(presets.paramNames.size()));
+        for (const auto &paramName : presets.paramNames)
+            writer.WriteString(paramName);
+
+        writer.Write<uint32_t>(static_cast<uint32_t>(presets.presets.size()));
+        for (const auto &preset : presets.presets) {
+            writer.WriteString(preset.name);
+            for (double value : preset.values)
+                writer.Write(value);
+        }
+    }
+    return writer.Take();
+}
+
+std::vector<std::string>
+PresetBank::GetNames(const std::string &algorithm) const {
+    std::vector<std::string> names;
+    auto it = mAlgorithms.find(algorithm);
+    if (it != mAlgorithms.end()) {
+        for (const auto &preset : it->second.presets)
+            names.push_back(preset.name);
+    }
+    return names;
+}
+
+bool PresetBank::Get(const std::string &algorithm, const std::string &name,
+                     const std::vector<std::string> &paramNames,
+                     std::vector<double> &values) const {
+    auto it = mAlgorithms.find(algorithm);
+    if (it == mAlgorithms.end())
+        return false;
+    const AlgorithmPresets &presets = it->second;
+    auto preset = std::find_if(
+        presets.presets.begin(), presets.presets.end(),
+        [&name](const Preset &candidate) { return candidate.name == name; });
+    if (preset == presets.presets.end())
+        return false;
+
+    if (paramNames == presets.paramNames) {
+        values = preset->values;
+        return true;
+    }
+
+    values.assign(paramNames.size(), std::numeric_limits<double>::quiet_NaN());
+    for (size_t i = 0; i < paramNames.size(); i++) {
+        auto stored = std::find(presets.paramNames.begin(),
+                                presets.paramNames.end(), paramNames[i]);
+        if (stored != presets.paramNames.end())
+            values[i] = preset->values[stored - presets.paramNames.begin()];
+    }
+    return true;
+}
+
+void PresetBank::Store(const std::string &algorithm, const std::string &name,
+                       const std::vector<std::string> &paramNames,
+                       std::vector<double> values) {
+    AlgorithmPresets &presets = mAlgorithms[algorithm];
+    if (presets.paramNames != paramNames)
+        Remap(presets, paramNames);
+
+    auto preset = std::find_if(
+        presets.presets.begin(), presets.presets.end(),
+        [&name](const Preset &candidate) { return candidate.name == name; });
+    if (preset != presets.presets.end())
+        preset->values = std::move(values);
+    else
+        presets.presets.push_back({name, std::move(values)});
+}
+
+bool PresetBank::Remove(const std::string &algorithm,
+                        const std::string &name) {
+    auto it = mAlgorithms.find(algorithm);
+    if (it == mAlgorithms.end())
+        return false;
+    auto &presets = it->second.presets;
+    auto preset = std::find_if(
+        presets.begin(), presets.end(),
+        [&name](const Preset &candidate) { return candidate.name == name; });
+    if (preset == presets.end())
+        return false;
+    presets.erase(preset);
+    return true;
+}
+
+void PresetBank::Remap(AlgorithmPresets &presets,
+                       const std::vector<std::string> &paramNames) {
+    for (auto &preset : presets.presets) {
+        std::vector<double> values(paramNames.size(),
+                                   std::numeric_limits<double>::quiet_NaN());
+        for (size_t i = 0; i < paramNames.size(); i++) {
+            auto stored = std::find(presets.paramNames.begin(),
+                                    presets.paramNames.end(), paramNames[i]);
+            if (stored != presets.paramNames.end())
+                values[i] = preset.values[stored - presets.paramNames.begin()];
+        }
+        preset.values = std::move(values);
+    }
+    presets.paramNames = paramNames;
+}
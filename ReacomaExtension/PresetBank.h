@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Named sets of parameter values for each algorithm. The bank is read once
+// and kept in memory, so switching presets only sets parameters. Values
+// are stored against parameter names; an algorithm that gains or loses
+// parameters keeps its presets, and parameters a preset doesn't know are
+// left as they are. The binary form is written with a SettingsWriter.
+class PresetBank {
+public:
+    // Bump whenever the layout of the serialised bank changes
+    static constexpr uint32_t kVersion = 1;
+
+    // Replaces the bank with the one in path; false if it can't be read
+    bool Load(const std::string &path);
+    std::string Serialise() const;
+
+    std::vector<std::string> GetNames(const std::string &algorithm) const;
+    // Values of the preset in the order of paramNames, NaN for parameters
+    // the preset doesn't have
+    bool Get(const std::string &algorithm, const std::string &name,
+             const std::vector<std::string> &paramNames,
+             std::vector<double> &values) const;
+    // Adds the preset, or replaces the one with the same name
+    void Store(const std::string &algorithm, const std::string &name,
+               const std::vector<std::string> &paramNames,
+               std::vector<double> values);
+    bool Remove(const std::string &algorithm, const std::string &name);
+
+private:
+    struct Preset {
+        std::string name;
+        std::vector<double> values;
+    };
+
+    struct AlgorithmPresets {
+        std::vector<std::string> paramNames;
+        std::vector<Preset> presets;
+    };
+
+    // Reorders every preset of presets to paramNames
+    static void Remap(AlgorithmPresets &presets,
+                      const std::vector<std::string> &paramNames);
+
+    std::map<std::string, AlgorithmPresets> mAlgorithms;
+};
@@ -0,0 +1,168 @@
+#include "PreviewTakes.h"
+#include "PeakBuilder.h"
+
+#include "wdltypes.h"
+#include "reaper_plugin_functions.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+// Serves interleaved float audio from memory. REAPER duplicates decoders
+// for each reader, so the samples are shared and only the read position is
+// per copy.
+class MemoryDecoder : public ISimpleMediaDecoder {
+public:
+    MemoryDecoder(std::shared_ptr<const std::vector<float>> audio,
+                  int numChans, int sampleRate, const std::string &name)
+        : mAudio(std::move(audio)), mNumChans(numChans),
+          mSampleRate(sampleRate), mName(name) {}
+
+    ISimpleMediaDecoder *Duplicate() override {
+        return new MemoryDecoder(mAudio, mNumChans, mSampleRate, mName);
+    }
+
+    void Open(const char *filename, int diskreadmode, int diskreadbs,
+              int diskreadnb) override {}
+    void Close(bool fullClose) override {}
+
+    const char *GetFileName() override { return mName.c_str(); }
+    const char *GetType() override { return "REACOMA"; }
+    void GetInfo(char *infostr, int infostr_size) override {
+        if (infostr && infostr_size > 0)
+            snprintf(infostr, infostr_size, "Reacoma preview (in memory)");
+    }
+
+    int GetNumChannels() override { return mNumChans; }
+    int GetBitsPerSample() override { return 32; }
+    double GetSampleRate() override { return mSampleRate; }
+    INT64 GetLength() override {
+        return static_cast<INT64>(mAudio->size() / mNumChans);
+    }
+    INT64 GetPosition() override { return mPosition; }
+    void SetPosition(INT64 pos) override {
+        mPosition = std::max<INT64>(0, std::min(pos, GetLength()));
+    }
+
+    int ReadSamples(ReaSample *buf, int length) override {
+        const int frames = static_cast<int>(std::clamp<INT64>(
+            GetLength() - mPosition, 0, std::max(0, length)));
+        const float *samples =
+            mAudio->data() + static_cast<size_t>(mPosition) * mNumChans;
+        std::copy(samples, samples + static_cast<size_t>(frames) * mNumChans,
+                  buf);
+        mPosition += frames;
+        return frames;
+    }
+
+private:
+    std::shared_ptr<const std::vector<float>> mAudio;
+    int mNumChans;
+    int mSampleRate;
+    std::string mName;
+    INT64 mPosition = 0;
+};
+
+std::string MakePreviewName(const PreviewTakes::Preview &preview) {
+    return preview.suffix + preview.takeSuffix + " (preview)";
+}
+
+} // namespace
+
+bool PreviewTakes::ShowAudio(Preview preview) {
+    const auto &audio = preview.audio;
+    if (!audio || preview.numChans <= 0 ||
+        audio->size() < size_t(preview.numChans))
+        return false;
+
+    const std::string name = MakePreviewName(preview);
+    PCM_source *source = PCM_Source_CreateFromSimple(
+        new MemoryDecoder(audio, preview.numChans, preview.sampleRate, name),
+        name.c_str());
+    if (!source)
+        return false;
+
+    preview.path.clear();
+    return Show(std::move(preview), source);
+}
+
+bool PreviewTakes::ShowFile(Preview preview) {
+    PCM_source *source = PCM_Source_CreateFromFile(preview.path.c_str());
+    if (!source)
+        return false;
+
+    preview.audio = nullptr;
+    return Show(std::move(preview), source);
+}
+
+bool PreviewTakes::Show(Preview preview, PCM_source *source) {
+    RemoveDeleted();
+
+    MediaItem_Take *take = nullptr;
+    for (auto &[existingTake, existing] : mPreviews) {
+        if (existing.item == preview.item &&
+            existing.suffix == preview.suffix &&
+            existing.takeSuffix == preview.takeSuffix) {
+            take = existingTake;
+            ReplaceSource(take, source);
+            break;
+        }
+    }
+
+    if (!take) {
+        take = AddTakeToMediaItem(preview.item);
+        if (!take) {
+            delete source;
+            return false;
+        }
+        GetSetMediaItemTakeInfo(take, "P_SOURCE", source);
+        GetSetMediaItemTakeInfo(take, "P_NAME",
+                                (char *)MakePreviewName(preview).c_str());
+    }
+    SetMediaItemTakeInfo_Value(take, "I_CHANMODE", preview.channelMode);
+    SetActiveTake(take);
+    mPeakBuilder.Add(take);
+
+    preview.take = take;
+    mPreviews[take] = std::move(preview);
+    return true;
+}
+
+MediaItem_Take *PreviewTakes::GetInputTake(MediaItem *item) const {
+    MediaItem_Take *take = GetActiveTake(item);
+    auto it = mPreviews.find(take);
+    if (it == mPreviews.end())
+        return take;
+
+    MediaItem_Take *inputTake = it->second.inputTake;
+    return ValidatePtr2(nullptr, inputTake, "MediaItem_Take*") ? inputTake
+                                                                : take;
+}
+
+std::vector<PreviewTakes::Preview> PreviewTakes::TakeAll() {
+    RemoveDeleted();
+
+    std::vector<Preview> previews;
+    previews.reserve(mPreviews.size());
+    for (auto &entry : mPreviews)
+        previews.push_back(std::move(entry.second));
+    mPreviews.clear();
+    return previews;
+}
+
+void PreviewTakes::ReplaceSource(MediaItem_Take *take, PCM_source *source) {
+    PCM_source *previous =
+        (PCM_source *)GetSetMediaItemTakeInfo(take, "P_SOURCE", nullptr);
+    GetSetMediaItemTakeInfo(take, "P_SOURCE", source);
+    delete previous;
+}
+
+void PreviewTakes::RemoveDeleted() {
+    for (auto it = mPreviews.begin(); it != mPreviews.end();) {
+        if (ValidatePtr2(nullptr, it->first, "MediaItem_Take*"))
+            ++it;
+        else
+            it = mPreviews.erase(it);
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "reaper_plugin.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Takes that show the outcome of an auto-process run without writing any
+// files. Each output of an item (e.g. "harmonic") gets a single preview take
+// whose source is swapped on every run, reading the rendered audio straight
+// from memory. Committing a preview writes it to disk and turns it into an
+// ordinary take. Previews don't survive a restart of REAPER; their sources
+// are offline if the project is reopened uncommitted.
+class PeakBuilder;
+
+class PreviewTakes {
+public:
+    explicit PreviewTakes(PeakBuilder &peakBuilder)
+        : mPeakBuilder(peakBuilder) {}
+
+    struct Preview {
+        MediaItem *item = nullptr;
+        MediaItem_Take *take = nullptr;
+        // The take the preview was rendered from
+        MediaItem_Take *inputTake = nullptr;
+        // Names the file the preview is committed to. Several takes may read
+        // channel ranges of one file; takeSuffix then tells them apart.
+        std::string suffix;
+        std::string takeSuffix;
+        // I_CHANMODE of the take
+        int channelMode = 0;
+        // Interleaved audio held in memory, or empty if the preview reads a
+        // file that is already on disk
+        std::shared_ptr<const std::vector<float>> audio;
+        int numChans = 0;
+        int sampleRate = 0;
+        std::string path;
+    };
+
+    // Shows preview.audio in the item's preview take for the same suffixes,
+    // creating the take if needed and making it the active take
+    bool ShowAudio(Preview preview);
+    // As ShowAudio(), for a result that was already rendered to preview.path
+    bool ShowFile(Preview preview);
+
+    // The take an item's audio should be read from: while a preview take is
+    // active, the take it was rendered from
+    MediaItem_Take *GetInputTake(MediaItem *item) const;
+
+    // Hands over every preview whose take still exists, leaving none
+    std::vector<Preview> TakeAll();
+    bool IsEmpty() const { return mPreviews.empty(); }
+
+    // Points take at source, deleting the source it replaces
+    static void ReplaceSource(MediaItem_Take *take, PCM_source *source);
+
+private:
+    bool Show(Preview preview, PCM_source *source);
+    void RemoveDeleted();
+
+    PeakBuilder &mPeakBuilder;
+    std::unordered_map<MediaItem_Take *, Preview> mPreviews;
+};
@@ -6,10 +6,30 @@
 #include "ReacomaExtension.h"
 #include "ReaperExt_include_in_plug_src.h"
 
+#include <algorithm>
 #include <fstream>
+#include <map>
 #include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <sstream>
+#include <thread>
 
 #include "ReacomaTheme.h"
+#include "AnalysisCache.h"
+#include "CorpusIndex.h"
+#include "DescriptorQueue.h"
+#include "Hasher.h"
+#include "ItemOverrides.h"
+#include "OutputQueue.h"
+#include "OutputStore.h"
+#include "PeakBuilder.h"
+#include "PresetBank.h"
+#include "PreviewTakes.h"
+#include "ResultMemo.h"
+#include "SettingsWriter.h"
+#include "StageCache.h"
 #include "Algorithms/ProcessingJob.h"
 #include "Components/ReacomaButton.h"
 #include "Components/ReacomaParamTextControl.h"
@@ -23,6 +43,8 @@
 #include "Algorithms/OnsetSliceAlgorithm.h"
 #include "Algorithms/AmpGateAlgorithm.h"
 #include "Algorithms/AmpSliceAlgorithm.h"
+#include "Algorithms/NoveltyFeatureAlgorithm.h"
+#include "Algorithms/SinesAlgorithm.h"
 
 template <ReacomaExtension::Mode M> struct ProcessAction {
     void operator()(IControl *pCaller) {
@@ -35,6 +57,19 @@ ReacomaExtension::ReacomaExtension(reaper_plugin_info_t *pRec)
     : ReaperExtBase(pRec) {
 
     mTheme = std::make_unique<ReacomaTheme>();
+    mResultMemo = std::make_unique<ResultMemo>();
+    mStageCache = std::make_unique<StageCache>();
+    mOutputStore = std::make_unique<OutputStore>();
+    mOutputQueue = std::make_unique<OutputQueue>(*mOutputStore);
+    mDescriptorQueue = std::make_unique<DescriptorQueue>(
+        static_cast<int>(std::thread::hardware_concurrency()));
+    mPeakBuilder = std::make_unique<PeakBuilder>();
+    mPreviewTakes = std::make_unique<PreviewTakes>(*mPeakBuilder);
+    mSettingsWriter = std::make_unique<SettingsWriter>();
+    mPresetBank = std::make_unique<PresetBank>();
+    mPresetWriter = std::make_unique<SettingsWriter>();
+    mCorpusIndex = std::make_unique<CorpusIndex>();
+    mCorpusWriter = std::make_unique<SettingsWriter>();
 
     IMPAPI(CountSelectedMediaItems);
     IMPAPI(GetSelectedMediaItem);
@@ -53,7 +88,13 @@ ReacomaExtension::ReacomaExtension(reaper_plugin_info_t *pRec)
     IMPAPI(SplitMediaItem);
     IMPAPI(DeleteTrackMediaItem);
     IMPAPI(SetTakeMarker);
+    IMPAPI(GetTakeMarker);
+    IMPAPI(PreventUIRefresh);
     IMPAPI(AddProjectMarker2);
+    IMPAPI(EnumProjectMarkers3);
+    IMPAPI(SetProjectMarker4);
+    IMPAPI(DeleteProjectMarker);
+    IMPAPI(GetSetMediaItemInfo_String);
     IMPAPI(GetMediaItem_Track);
     IMPAPI(Undo_BeginBlock2);
     IMPAPI(Undo_EndBlock2);
@@ -68,10 +109,35 @@ ReacomaExtension::ReacomaExtension(reaper_plugin_info_t *pRec)
     IMPAPI(PCM_Sink_CreateEx);
     IMPAPI(PCM_Source_CreateFromFile);
     IMPAPI(GetMediaSourceParent);
+    IMPAPI(PCM_Source_GetSectionInfo);
     IMPAPI(GetMediaSourceFileName);
     IMPAPI(GetProjectPathEx);
     IMPAPI(GetSetProjectInfo_String);
     IMPAPI(SetMediaItemInfo_Value);
+    IMPAPI(GetProjectStateChangeCount);
+    IMPAPI(ValidatePtr2);
+    IMPAPI(SetActiveTake);
+    IMPAPI(SetMediaItemTakeInfo_Value);
+    IMPAPI(EnumProjects);
+    IMPAPI(CountMediaItems);
+    IMPAPI(GetMediaItem);
+    IMPAPI(CountTakes);
+    IMPAPI(GetTake);
+    IMPAPI(ShowMessageBox);
+    IMPAPI(GetUserInputs);
+    IMPAPI(GetSetMediaItemTakeInfo_String);
+    IMPAPI(GetTakeEnvelopeByName);
+    IMPAPI(GetEnvelopeScalingMode);
+    IMPAPI(ScaleToEnvelopeMode);
+    IMPAPI(DeleteEnvelopePointRange);
+    IMPAPI(InsertEnvelopePoint);
+    IMPAPI(Envelope_SortPoints);
+    IMPAPI(SetEnvelopeStateChunk);
+    IMPAPI(SelectAllMediaItems);
+    IMPAPI(SetMediaItemSelected);
+    IMPAPI(Main_OnCommand);
+    IMPAPI(GetCursorPosition);
+    IMPAPI(GetMediaItemTakeByGUID);
 
     mMakeGraphicsFunc = [&]() {
         return MakeGraphics(*this, PLUG_WIDTH, PLUG_HEIGHT, PLUG_FPS);
@@ -85,13 +151,45 @@ ReacomaExtension::ReacomaExtension(reaper_plugin_info_t *pRec)
         },
         true, &mGUIToggle);
 
+    RegisterAction("Reacoma: Clear analysis cache", [&]() {
+        if (mAnalysisCache)
+            mAnalysisCache->Clear();
+        mResultMemo->Clear();
+        mStageCache->Clear();
+        UpdateCacheStatsLabel();
+    });
+
+    RegisterAction("Reacoma: Commit preview takes",
+                   [&]() { CommitPreviews(); });
+
+    RegisterAction("Reacoma: Delete unused output files",
+                   [&]() { CollectUnusedOutputs(); });
+
+    RegisterAction("Reacoma: Store current parameters on selected items",
+                   [&]() { StoreSelectionOverrides(); });
+
+    RegisterAction("Reacoma: Clear parameters stored on selected items",
+                   [&]() { ClearSelectionOverrides(); });
+
+    RegisterAction("Reacoma: Describe slices of selected items",
+                   [&]() { DescribeSelection(); });
+
+    RegisterAction("Reacoma: Find slices similar to the one at the cursor",
+                   [&]() { FindSimilarSlices(); });
+
     AddParam();
     auto parameterLabels = {"Novelty Slice", "Amp Slice",       "Amp Gate",
                             "Onset Slice",   "Transient Slice", "HPSS",
-                            "NMF",           "Transients"};
+                            "NMF",           "Transients",
+                            "Novelty Feature", "Sines"};
     GetParam(kParamAlgorithmChoice)
         ->InitEnum("Algorithm", kNoveltySlice, parameterLabels);
 
+    AddParam();
+    GetParam(kParamOutputFormat)
+        ->InitEnum("Output Format", kOutputFloat32,
+                   {"Float", "24-bit", "16-bit", "FLAC", "WavPack"});
+
     mNoveltyAlgorithm = std::make_unique<NoveltySliceAlgorithm>(this);
     mNoveltyAlgorithm->RegisterParameters();
 
@@ -116,6 +214,12 @@ ReacomaExtension::ReacomaExtension(reaper_plugin_info_t *pRec)
     mAmpSliceAlgorithm = std::make_unique<AmpSliceAlgorithm>(this);
     mAmpSliceAlgorithm->RegisterParameters();
 
+    mNoveltyFeatureAlgorithm = std::make_unique<NoveltyFeatureAlgorithm>(this);
+    mNoveltyFeatureAlgorithm->RegisterParameters();
+
+    mSinesAlgorithm = std::make_unique<SinesAlgorithm>(this);
+    mSinesAlgorithm->RegisterParameters();
+
     mAllAlgorithms.push_back(mNoveltyAlgorithm.get());
     mAllAlgorithms.push_back(mHPSSAlgorithm.get());
     mAllAlgorithms.push_back(mNMFAlgorithm.get());
@@ -124,12 +228,19 @@ ReacomaExtension::ReacomaExtension(reaper_plugin_info_t *pRec)
     mAllAlgorithms.push_back(mTransientSliceAlgorithm.get());
     mAllAlgorithms.push_back(mAmpGateAlgorithm.get());
     mAllAlgorithms.push_back(mAmpSliceAlgorithm.get());
+    mAllAlgorithms.push_back(mNoveltyFeatureAlgorithm.get());
+    mAllAlgorithms.push_back(mSinesAlgorithm.get());
 
     SetAlgorithmChoice(kNoveltySlice, false);
 
     mLayoutFunc = [&](IGraphics *pGraphics) { SetupUI(pGraphics); };
 }
 
+ReacomaExtension::~ReacomaExtension() {
+    if (mSettingsChanged)
+        SaveState();
+}
+
 void ReacomaExtension::OnUIClose() {
     SaveState();
     mGUIToggle = 0;
@@ -141,6 +252,8 @@ void ReacomaExtension::SetupUI(IGraphics *pGraphics) {
     mProgressBar = nullptr;
     mCancelButton = nullptr;
     mAutoProcessButton = nullptr;
+    mCacheStatsLabel = nullptr;
+    mPresetChooser = nullptr;
     mHasUserInteractedSinceLoad = false;
     mAutoProcessMode = false;
 
@@ -159,6 +272,7 @@ void ReacomaExtension::SetupUI(IGraphics *pGraphics) {
     const float verticalSpacing = 7.f;
     const float controlVisualHeight = 25.f;
     const float actionButtonHeight = 30.f;
+    const float statusTextHeight = 16.f;
 
     // --- Main Layout Areas ---
     IRECT mainContentArea = bounds.GetPadded(-globalFramePadding);
@@ -169,11 +283,21 @@ void ReacomaExtension::SetupUI(IGraphics *pGraphics) {
     IRECT bottomUtilityRowBounds =
         remainingArea.GetFromBottom(controlVisualHeight);
     remainingArea.B -= (bottomUtilityRowBounds.H() + verticalSpacing);
+    IRECT statusRowBounds = remainingArea.GetFromBottom(statusTextHeight);
+    remainingArea.B -= (statusRowBounds.H() + verticalSpacing);
     IRECT actionButtonRowBounds =
         remainingArea.GetFromBottom(actionButtonHeight);
     remainingArea.B -= (actionButtonRowBounds.H() + verticalSpacing);
     IRECT currentLayoutBounds = remainingArea;
 
+    const IVStyle menuButtonStyle =
+        DEFAULT_STYLE.WithColor(kFG, theme.inactive)
+            .WithColor(kBG, theme.bg)
+            .WithColor(kPR, theme.inactive)
+            .WithLabelText(theme.buttonStyle)
+            .WithValueText(theme.buttonStyle)
+            .WithDrawShadows(false);
+
     // --- Algorithm Chooser Dropdown ---
     const float algoSelectorHeight = 60.f;
     if (currentLayoutBounds.H() >= algoSelectorHeight) {
@@ -181,14 +305,6 @@ void ReacomaExtension::SetupUI(IGraphics *pGraphics) {
             currentLayoutBounds.GetFromTop(algoSelectorHeight);
         currentLayoutBounds.T = algorithmSelectorRect.B + verticalSpacing;
 
-        const IVStyle menuButtonStyle =
-            DEFAULT_STYLE.WithColor(kFG, theme.inactive)
-                .WithColor(kBG, theme.bg)
-                .WithColor(kPR, theme.inactive)
-                .WithLabelText(theme.buttonStyle)
-                .WithValueText(theme.buttonStyle)
-                .WithDrawShadows(false);
-
         auto *pAlgoChooser = new IVButtonControl(
             algorithmSelectorRect,
             [this, pGraphics](IControl *pCaller) {
@@ -227,6 +343,63 @@ void ReacomaExtension::SetupUI(IGraphics *pGraphics) {
     if (!mCurrentActiveAlgorithmPtr)
         return;
 
+    // --- Presets ---
+    if (currentLayoutBounds.H() >= controlVisualHeight) {
+        IRECT presetRowRect =
+            currentLayoutBounds.GetFromTop(controlVisualHeight);
+        currentLayoutBounds.T = presetRowRect.B + verticalSpacing;
+
+        const float saveButtonWidth = 80.f;
+        IRECT saveBounds = presetRowRect.GetFromRight(saveButtonWidth);
+        IRECT chooserBounds =
+            presetRowRect.GetReducedFromRight(saveButtonWidth + theme.padding);
+
+        mPresetChooser = new IVButtonControl(
+            chooserBounds,
+            [this, pGraphics](IControl *pCaller) {
+                SplashClickActionFunc(pCaller);
+                static IPopupMenu menu{
+                    "", {}, [this](IPopupMenu *pMenu) {
+                        const int itemIndex = pMenu->GetChosenItemIdx();
+                        const int numPresets =
+                            static_cast<int>(mPresetMenuNames.size());
+                        if (itemIndex < 0)
+                            return;
+                        if (itemIndex < numPresets)
+                            ApplyPreset(mPresetMenuNames[itemIndex]);
+                        else if (itemIndex > numPresets)
+                            DeletePreset(mCurrentPresetName);
+                    }};
+
+                menu.Clear();
+                mPresetMenuNames = mPresetBank->GetNames(
+                    GetAlgorithmKey(mCurrentAlgorithmChoice));
+                for (const auto &name : mPresetMenuNames)
+                    menu.AddItem(name.c_str());
+                if (mPresetMenuNames.empty())
+                    menu.AddItem("No presets", -1,
+                                 IPopupMenu::Item::kDisabled);
+                // Chosen past the presets and the separator
+                if (!mCurrentPresetName.empty()) {
+                    menu.AddSeparator();
+                    const std::string label =
+                        "Delete \"" + mCurrentPresetName + "\"";
+                    menu.AddItem(label.c_str());
+                }
+
+                float x, y;
+                pGraphics->GetMouseDownPoint(x, y);
+                pGraphics->CreatePopupMenu(*pCaller, menu, x, y);
+            },
+            "", menuButtonStyle, false, true);
+        pGraphics->AttachControl(mPresetChooser);
+        UpdatePresetChooser();
+
+        pGraphics->AttachControl(new ReacomaButton(
+            saveBounds.GetHPadded(-theme.padding), "Save",
+            [this](IControl *pCaller) { SavePresetAs(); }, theme));
+    }
+
     // --- Algorithm Parameter Controls ---
     int numAlgoParams = mCurrentActiveAlgorithmPtr->GetNumAlgorithmParams();
     for (int i = 0; i < numAlgoParams; ++i) {
@@ -256,6 +429,21 @@ void ReacomaExtension::SetupUI(IGraphics *pGraphics) {
         currentLayoutBounds.T = controlCellRect.B + verticalSpacing;
     }
 
+    // --- Output Format ---
+    if (mCurrentActiveAlgorithmPtr->CreatesTakes() &&
+        currentLayoutBounds.H() >= controlVisualHeight) {
+        IParam *pFormatParam = GetParam(kParamOutputFormat);
+        std::vector<std::string> labels;
+        for (int val = 0; val <= pFormatParam->GetMax(); ++val)
+            labels.push_back(pFormatParam->GetDisplayTextAtIdx(val));
+
+        IRECT controlCellRect =
+            currentLayoutBounds.GetFromTop(controlVisualHeight);
+        pGraphics->AttachControl(new ReacomaSegmented(
+            controlCellRect, kParamOutputFormat, labels, theme));
+        currentLayoutBounds.T = controlCellRect.B + verticalSpacing;
+    }
+
     // --- Action Buttons ---
     struct ButtonInfo {
         IActionFunction function;
@@ -269,9 +457,17 @@ void ReacomaExtension::SetupUI(IGraphics *pGraphics) {
     if (mCurrentActiveAlgorithmPtr->SupportsRegions()) {
         buttonsToCreate.push_back({ProcessAction<Mode::Regions>{}, "Regions"});
     }
+    if (mCurrentActiveAlgorithmPtr->SupportsSplitting()) {
+        buttonsToCreate.push_back({ProcessAction<Mode::Split>{}, "Split"});
+    }
+    if (mCurrentActiveAlgorithmPtr->WritesCurve()) {
+        buttonsToCreate.push_back({ProcessAction<Mode::Curve>{}, "Curve"});
+    }
     if (mCurrentActiveAlgorithmPtr->CreatesTakes()) {
         buttonsToCreate.push_back(
             {ProcessAction<Mode::ProcessAudio>{}, "Process"});
+        buttonsToCreate.push_back(
+            {[this](IControl *pCaller) { CommitPreviews(); }, "Commit"});
     }
 
     const int numActionButtons = buttonsToCreate.size();
@@ -319,6 +515,12 @@ void ReacomaExtension::SetupUI(IGraphics *pGraphics) {
         theme);
     pGraphics->AttachControl(mCancelButton);
     mCancelButton->SetDisabled(true);
+
+    // --- Status Row ---
+    mCacheStatsLabel = new ITextControl(
+        statusRowBounds.GetHPadded(-theme.padding), "", theme.labelStyle);
+    pGraphics->AttachControl(mCacheStatsLabel);
+    UpdateCacheStatsLabel();
 }
 
 void ReacomaExtension::UpdateAutoProcessButtonState() {
@@ -332,19 +534,185 @@ void ReacomaExtension::UpdateAutoProcessButtonState() {
     }
 }
 
+void ReacomaExtension::UpdateCacheStatsLabel() {
+    if (!mCacheStatsLabel)
+        return;
+
+    char text[128];
+    snprintf(text, sizeof(text),
+             "Result memo: %.0f%% hit rate (%zu/%zu)  Last batch wrote %.1f MB",
+             mResultMemo->GetHitRate() * 100.0, mResultMemo->GetHits(),
+             mResultMemo->GetLookups(),
+             mOutputQueue->GetBytesWritten() / (1024.0 * 1024.0));
+    mCacheStatsLabel->SetStr(text);
+    mCacheStatsLabel->SetDirty(false);
+}
+
+void ReacomaExtension::CommitPreviews() {
+    if (mIsProcessingBatch || mIsCommittingPreviews)
+        return;
+
+    std::vector<PreviewTakes::Preview> previews = mPreviewTakes->TakeAll();
+    if (previews.empty())
+        return;
+
+    mIsCommittingPreviews = true;
+    mCommitUndoProject = GetItemProjectContext(previews.front().item);
+    Undo_BeginBlock2(mCommitUndoProject);
+    mOutputQueue->ResetBytesWritten();
+
+    // Takes that read channel ranges of one rendered output share its file
+    std::map<const std::vector<float> *, std::vector<PreviewTakes::Preview>>
+        files;
+    for (auto &preview : previews) {
+        // Restored from a file that is already on disk
+        if (!preview.audio) {
+            std::string takeName =
+                std::filesystem::u8path(preview.path).stem().u8string() +
+                preview.takeSuffix;
+            GetSetMediaItemTakeInfo(preview.take, "P_NAME",
+                                    (char *)takeName.c_str());
+            continue;
+        }
+        files[preview.audio.get()].push_back(std::move(preview));
+    }
+
+    for (auto &[audioPtr, filePreviews] : files) {
+        const PreviewTakes::Preview &first = filePreviews.front();
+        std::string fileTakeName;
+
+        OutputQueue::Request request;
+        request.path =
+            MakeOutputPath(first.inputTake, first.suffix, fileTakeName);
+        request.numChans = first.numChans;
+        request.sampleRate = first.sampleRate;
+        request.format = GetOutputFormat();
+        request.render = [audio = first.audio, numChans = first.numChans](
+                             OutputWriter &writer, PCM_sink *sink) {
+            writer.Write(sink, audio->data(),
+                         static_cast<int>(audio->size() / numChans),
+                         numChans);
+            return true;
+        };
+        request.hashContent = [audio = first.audio]() {
+            Hasher hasher;
+            hasher.Add(audio->data(), audio->size() * sizeof(float));
+            return hasher.Get();
+        };
+
+        std::vector<std::pair<MediaItem_Take *, std::string>> takes;
+        for (const auto &preview : filePreviews)
+            takes.emplace_back(preview.take, fileTakeName + preview.takeSuffix);
+        request.onComplete = [this, takes, path = request.path](bool ok) {
+            if (!ok)
+                return;
+            for (const auto &[take, takeName] : takes) {
+                if (!ValidatePtr2(nullptr, take, "MediaItem_Take*"))
+                    continue;
+                PCM_source *source = PCM_Source_CreateFromFile(path.c_str());
+                if (!source)
+                    continue;
+                PreviewTakes::ReplaceSource(take, source);
+                GetSetMediaItemTakeInfo(take, "P_NAME",
+                                        (char *)takeName.c_str());
+                mPeakBuilder->Add(take);
+            }
+        };
+        mOutputQueue->Submit(std::move(request));
+    }
+}
+
+void ReacomaExtension::CollectUnusedOutputs() {
+    if (mIsProcessingBatch || mIsCommittingPreviews ||
+        !mOutputQueue->IsIdle())
+        return;
+
+    // Every file a take reads in any open project, preview takes included
+    std::vector<std::string> referencedFiles;
+    ReaProject *project = nullptr;
+    for (int p = 0; (project = EnumProjects(p, nullptr, 0)); p++) {
+        for (int i = 0; i < CountMediaItems(project); i++) {
+            MediaItem *item = GetMediaItem(project, i);
+            for (int t = 0; t < CountTakes(item); t++) {
+                MediaItem_Take *take = GetTake(item, t);
+                PCM_source *source =
+                    take ? GetMediaItemTake_Source(take) : nullptr;
+                if (!source)
+                    continue;
+                char fileName[4096] = "";
+                PCM_source *parent = GetMediaSourceParent(source);
+                GetMediaSourceFileName(parent ? parent : source, fileName,
+                                       sizeof(fileName));
+                if (fileName[0] != '\0')
+                    referencedFiles.push_back(fileName);
+            }
+        }
+    }
+
+    OutputStore::GarbageReport found;
+    const std::vector<std::string> garbage =
+        OutputStore::FindGarbage(referencedFiles, found);
+    if (found.numFiles == 0) {
+        ShowMessageBox("No unused output files were found.", "Reacoma", 0);
+        return;
+    }
+
+    char message[512];
+    snprintf(message, sizeof(message),
+             "Delete %zu rendered files (%.1f MB) in reacoma folders that no "
+             "take in an open project uses?\n\nThis cannot be undone.",
+             found.numFiles, found.numBytes / (1024.0 * 1024.0));
+    if (ShowMessageBox(message, "Reacoma", 4) != 6)
+        return;
+
+    const OutputStore::GarbageReport deleted =
+        OutputStore::DeleteFiles(garbage);
+    snprintf(message, sizeof(message), "Deleted %zu files (%.1f MB).",
+             deleted.numFiles, deleted.numBytes / (1024.0 * 1024.0));
+    ShowMessageBox(message, "Reacoma", 0);
+}
+
 void ReacomaExtension::Process(Mode mode, bool force) {
+    if (mCurrentActiveAlgorithmPtr == nullptr || mIsCommittingPreviews)
+        return;
+
     mCurrentProcessingMode = mode;
     mConcurrencyLimit = std::thread::hardware_concurrency();
 
+    mBatchParameters = std::make_shared<const ParameterSnapshot>(
+        ParameterSnapshot::Capture(this, *mCurrentActiveAlgorithmPtr));
+
+    Hasher settingsHasher;
+    settingsHasher.AddValue(mCurrentAlgorithmChoice);
+    settingsHasher.AddValue(mode);
+    settingsHasher.AddValue(mBatchParameters->GetHash());
+    settingsHasher.AddValue(GetOutputFormat());
+    mBatchSettingsHash = settingsHasher.Get();
+
+    for (auto it = mProcessedItemInputs.begin();
+         it != mProcessedItemInputs.end();) {
+        if (ValidatePtr2(nullptr, it->first, "MediaItem*"))
+            ++it;
+        else
+            it = mProcessedItemInputs.erase(it);
+    }
+
     mPendingItemsQueue.clear();
 
     for (int i = 0; i < CountSelectedMediaItems(0); ++i) {
-        mPendingItemsQueue.push_back(GetSelectedMediaItem(0, i));
+        MediaItem *item = GetSelectedMediaItem(0, i);
+        if (!force) {
+            auto it = mProcessedItemInputs.find(item);
+            if (it != mProcessedItemInputs.end() &&
+                it->second == HashItemInputs(item))
+                continue;
+        }
+        mPendingItemsQueue.push_back(item);
     }
 
     mTotalBatchItems = mPendingItemsQueue.size();
 
-    if (mPendingItemsQueue.empty() || mCurrentActiveAlgorithmPtr == nullptr) {
+    if (mPendingItemsQueue.empty()) {
         return;
     }
 
@@ -353,6 +721,8 @@ void ReacomaExtension::Process(Mode mode, bool force) {
     mLastReportedProgress = 0.0;
     mActiveJobs.clear();
     mFinalizationQueue.clear();
+    mBatchFinalisedItems.clear();
+    mOutputQueue->ResetBytesWritten();
 
     if (mProgressBar) {
         mProgressBar->SetProgress(0.0);
@@ -384,7 +754,14 @@ void ReacomaExtension::OnParamChangeUI(int paramIdx, EParamSource source) {
         mLastParamChangeTime = std::chrono::steady_clock::now();
     }
 
-    SaveState();
+    mSettingsChanged = true;
+    mLastSettingsChangeTime = std::chrono::steady_clock::now();
+
+    // Edited by hand, the values no longer are those of the preset
+    if (source == kUI && !mCurrentPresetName.empty()) {
+        mCurrentPresetName.clear();
+        UpdatePresetChooser();
+    }
 
     mHasUserInteractedSinceLoad = true;
 }
@@ -393,6 +770,10 @@ void ReacomaExtension::OnIdle() {
 
     if (!mStateLoaded) {
         LoadState();
+        mPresetBank->Load(GetPresetsFilePath());
+        std::string cachePath = GetCacheDirectoryPath();
+        if (!cachePath.empty())
+            mAnalysisCache = std::make_unique<AnalysisCache>(cachePath);
         SetAlgorithmChoice(static_cast<EAlgorithmChoice>(
                                GetParam(kParamAlgorithmChoice)->Int()),
                            true);
@@ -418,21 +799,74 @@ void ReacomaExtension::OnIdle() {
         }
     }
 
+    // Settings are saved once parameter changes have settled, rather than
+    // on every step of a slider drag
+    if (mSettingsChanged &&
+        std::chrono::steady_clock::now() - mLastSettingsChangeTime >
+            SETTINGS_SAVE_DELAY)
+        SaveState();
+
+    // Spread over idle callbacks so the batch's new takes are drawn without
+    // REAPER stalling to build their peaks
+    if (mPeakBuilder->Process(PEAK_BUILD_BUDGET))
+        UpdateArrange();
+
+    // Takes are read here rather than when the action runs, so a large
+    // selection doesn't hold every take's audio in memory at once
+    mDescriptorQueue->ProcessCompleted();
+    while (!mPendingDescriptorItems.empty() &&
+           mDescriptorQueue->HasCapacity()) {
+        MediaItem *item = mPendingDescriptorItems.front();
+        mPendingDescriptorItems.pop_front();
+        if (ValidatePtr2(nullptr, item, "MediaItem*"))
+            SubmitDescriptorRequest(item);
+    }
+
+    // Edits to the selection or to selected items re-trigger auto-process;
+    // Process() then skips every item whose inputs are unchanged. The
+    // extension's own edits are acknowledged once they are complete, so a
+    // batch doesn't trigger another pass over every item.
+    const int projectStateChangeCount = GetProjectStateChangeCount(nullptr);
+    if (projectStateChangeCount != mLastProjectStateChangeCount) {
+        mLastProjectStateChangeCount = projectStateChangeCount;
+        if (mAutoProcessMode && !mIsProcessingBatch) {
+            mProcessIsPending = true;
+            mLastParamChangeTime = std::chrono::steady_clock::now();
+        }
+    }
+
+    if (mIsCommittingPreviews) {
+        mOutputQueue->ProcessCompleted();
+        if (!mOutputQueue->IsIdle() || !mPeakBuilder->IsIdle())
+            return;
+
+        mIsCommittingPreviews = false;
+        Undo_EndBlock2(mCommitUndoProject, "Reacoma: Commit Previews", -1);
+        mCommitUndoProject = nullptr;
+        IgnoreOwnProjectChanges();
+
+        UpdateCacheStatsLabel();
+        UpdateArrange();
+    }
+
     if (mProcessIsPending && !mIsProcessingBatch) {
         const auto currentTime = std::chrono::steady_clock::now();
         if (currentTime - mLastParamChangeTime > AUTO_PROCESS_DELAY) {
             mProcessIsPending = false;
 
-            Mode modeToRun = mCurrentActiveAlgorithmPtr &&
-                                     mCurrentActiveAlgorithmPtr->CreatesTakes()
-                                 ? Mode::ProcessAudio
-                                 : Mode::Segment;
+            Mode modeToRun = Mode::Segment;
+            if (mCurrentActiveAlgorithmPtr &&
+                mCurrentActiveAlgorithmPtr->CreatesTakes())
+                modeToRun = Mode::ProcessAudio;
+            else if (mCurrentActiveAlgorithmPtr &&
+                     mCurrentActiveAlgorithmPtr->WritesCurve())
+                modeToRun = Mode::Curve;
 
             if (mIsProcessingBatch) {
                 CancelRunningJobs();
             }
 
-            Process(modeToRun, true);
+            Process(modeToRun, false);
         }
     }
 
@@ -440,6 +874,8 @@ void ReacomaExtension::OnIdle() {
         return;
     }
 
+    mOutputQueue->ProcessCompleted();
+
     if (mIsCancellationRequested) {
         for (auto &job : mActiveJobs) {
             job->Cancel();
@@ -450,12 +886,20 @@ void ReacomaExtension::OnIdle() {
         mActiveJobs.clear();
         mFinalizationQueue.clear();
 
+        // A file already being written still gets its take, inside the
+        // batch's undo block
+        mOutputQueue->CancelPending();
+        mOutputQueue->ProcessCompleted();
+        if (!mOutputQueue->IsIdle())
+            return;
+
         mIsProcessingBatch = false;
         mIsCancellationRequested = false;
 
         Undo_EndBlock2(mBatchUndoProject, "Reacoma: Batch Process Cancelled",
                        -1);
         mBatchUndoProject = nullptr;
+        IgnoreOwnProjectChanges();
 
         ResetUIState();
         UpdateArrange();
@@ -477,17 +921,18 @@ void ReacomaExtension::OnIdle() {
         MediaItem *itemToProcess = mPendingItemsQueue.front();
         mPendingItemsQueue.pop_front();
 
-        auto job =
-            ProcessingJob::Create(mCurrentAlgorithmChoice, itemToProcess, this);
+        auto job = ProcessingJob::Create(mCurrentAlgorithmChoice,
+                                         itemToProcess, this, mBatchParameters);
         if (job) {
             job->Start();
             mActiveJobs.push_back(std::move(job));
         }
     }
 
-    if (!mFinalizationQueue.empty()) {
+    if (!mFinalizationQueue.empty() && mOutputQueue->HasCapacity()) {
         auto &finishedJob = mFinalizationQueue.front();
-        finishedJob->Finalize();
+        if (finishedJob->Finalize())
+            mBatchFinalisedItems.push_back(finishedJob->mItem);
         mFinalizationQueue.pop_front();
     }
 
@@ -510,17 +955,30 @@ void ReacomaExtension::OnIdle() {
     }
 
     if (mPendingItemsQueue.empty() && mActiveJobs.empty() &&
-        mFinalizationQueue.empty()) {
+        mFinalizationQueue.empty() && mOutputQueue->IsIdle() &&
+        mPeakBuilder->IsIdle()) {
+        for (MediaItem *item : mBatchFinalisedItems) {
+            if (ValidatePtr2(nullptr, item, "MediaItem*"))
+                mProcessedItemInputs[item] = HashItemInputs(item);
+        }
+        mBatchFinalisedItems.clear();
+
         mIsProcessingBatch = false;
         Undo_EndBlock2(mBatchUndoProject, "Reacoma: Process Batch", -1);
         mBatchUndoProject = nullptr;
+        IgnoreOwnProjectChanges();
 
         ResetUIState();
+        UpdateCacheStatsLabel();
         UpdateArrange();
         UpdateTimeline();
     }
 }
 
+void ReacomaExtension::IgnoreOwnProjectChanges() {
+    mLastProjectStateChangeCount = GetProjectStateChangeCount(nullptr);
+}
+
 void ReacomaExtension::SetAlgorithmChoice(EAlgorithmChoice choice,
                                           bool triggerUIRelayout) {
     mCurrentAlgorithmChoice = choice;
@@ -549,10 +1007,17 @@ void ReacomaExtension::SetAlgorithmChoice(EAlgorithmChoice choice,
         case kAmpSlice:
             mCurrentActiveAlgorithmPtr = mAmpSliceAlgorithm.get();
             break;
+        case kNoveltyFeature:
+            mCurrentActiveAlgorithmPtr = mNoveltyFeatureAlgorithm.get();
+            break;
+        case kSines:
+            mCurrentActiveAlgorithmPtr = mSinesAlgorithm.get();
+            break;
         default:
             mCurrentActiveAlgorithmPtr = nullptr;
             break;
     }
+    mCurrentPresetName.clear();
     if (triggerUIRelayout) {
         mUIRelayoutIsNeeded = true;
     }
@@ -598,20 +1063,485 @@ std::string ReacomaExtension::GetSettingsFilePath() const {
     return "";
 }
 
+std::string ReacomaExtension::GetPresetsFilePath() const {
+    const char *resourcePath = GetResourcePath();
+    if (resourcePath && strlen(resourcePath) > 0) {
+        std::string path(resourcePath);
+        path += "/reacoma-presets.bin";
+        return path;
+    }
+    return "";
+}
+
+std::string ReacomaExtension::GetCorpusFilePath() const {
+    const char *resourcePath = GetResourcePath();
+    if (resourcePath && strlen(resourcePath) > 0) {
+        std::string path(resourcePath);
+        path += "/reacoma-corpus.bin";
+        return path;
+    }
+    return "";
+}
+
+std::string
+ReacomaExtension::GetAlgorithmKey(EAlgorithmChoice choice) const {
+    // Algorithm names aren't unique, their menu entries are
+    return GetParam(kParamAlgorithmChoice)->GetDisplayTextAtIdx(choice);
+}
+
+std::vector<std::string>
+ReacomaExtension::GetParamNames(const IAlgorithm &algorithm) const {
+    std::vector<std::string> names;
+    for (int i = 0; i < algorithm.GetNumAlgorithmParams(); ++i)
+        names.push_back(GetParam(algorithm.GetGlobalParamIdx(i))->GetName());
+    return names;
+}
+
+void ReacomaExtension::ApplyPreset(const std::string &name) {
+    std::vector<double> values;
+    if (!mCurrentActiveAlgorithmPtr ||
+        !mPresetBank->Get(GetAlgorithmKey(mCurrentAlgorithmChoice), name,
+                          GetParamNames(*mCurrentActiveAlgorithmPtr), values))
+        return;
+
+    // Updates the controls and goes through OnParamChangeUI(), so the
+    // settings are saved and auto-process re-runs; results of earlier runs
+    // with the same values come straight from the cache
+    for (int i = 0; i < static_cast<int>(values.size()); ++i) {
+        if (std::isnan(values[i]))
+            continue;
+        const int paramIdx = mCurrentActiveAlgorithmPtr->GetGlobalParamIdx(i);
+        GetParam(paramIdx)->Set(values[i]);
+        SendParameterValueFromDelegate(
+            paramIdx, GetParam(paramIdx)->GetNormalized(), true);
+    }
+
+    mCurrentPresetName = name;
+    UpdatePresetChooser();
+}
+
+void ReacomaExtension::SavePresetAs() {
+    if (!mCurrentActiveAlgorithmPtr)
+        return;
+
+    char name[256];
+    snprintf(name, sizeof(name), "%s", mCurrentPresetName.c_str());
+    if (!GetUserInputs("Save Reacoma preset", 1,
+                       "Preset name:,extrawidth=150", name, sizeof(name)) ||
+        name[0] == '\0')
+        return;
+
+    const ParameterSnapshot snapshot =
+        ParameterSnapshot::Capture(this, *mCurrentActiveAlgorithmPtr);
+    mPresetBank->Store(GetAlgorithmKey(mCurrentAlgorithmChoice), name,
+                       GetParamNames(*mCurrentActiveAlgorithmPtr),
+                       snapshot.GetValues());
+    mCurrentPresetName = name;
+    SavePresets();
+    UpdatePresetChooser();
+}
+
+void ReacomaExtension::DeletePreset(const std::string &name) {
+    if (!mPresetBank->Remove(GetAlgorithmKey(mCurrentAlgorithmChoice), name))
+        return;
+    if (name == mCurrentPresetName)
+        mCurrentPresetName.clear();
+    SavePresets();
+    UpdatePresetChooser();
+}
+
+void ReacomaExtension::StoreSelectionOverrides() {
+    if (!mCurrentActiveAlgorithmPtr || CountSelectedMediaItems(nullptr) == 0)
+        return;
+
+    const std::string algorithmKey = GetAlgorithmKey(mCurrentAlgorithmChoice);
+    const std::vector<std::string> paramNames =
+        GetParamNames(*mCurrentActiveAlgorithmPtr);
+    const ParameterSnapshot snapshot =
+        ParameterSnapshot::Capture(this, *mCurrentActiveAlgorithmPtr);
+
+    Undo_BeginBlock2(nullptr);
+    for (int i = 0; i < CountSelectedMediaItems(nullptr); ++i) {
+        MediaItem *item = GetSelectedMediaItem(nullptr, i);
+        if (MediaItem_Take *take = GetInputTake(item))
+            StoreItemOverrides(take, algorithmKey, paramNames,
+                               snapshot.GetValues());
+    }
+    Undo_EndBlock2(nullptr, "Reacoma: Store Item Parameters", -1);
+}
+
+void ReacomaExtension::ClearSelectionOverrides() {
+    if (CountSelectedMediaItems(nullptr) == 0)
+        return;
+
+    const std::string algorithmKey = GetAlgorithmKey(mCurrentAlgorithmChoice);
+    Undo_BeginBlock2(nullptr);
+    for (int i = 0; i < CountSelectedMediaItems(nullptr); ++i) {
+        MediaItem *item = GetSelectedMediaItem(nullptr, i);
+        if (MediaItem_Take *take = GetInputTake(item))
+            ClearItemOverrides(take, algorithmKey);
+    }
+    Undo_EndBlock2(nullptr, "Reacoma: Clear Item Parameters", -1);
+}
+
+void ReacomaExtension::DescribeSelection() {
+    for (int i = 0; i < CountSelectedMediaItems(nullptr); ++i) {
+        MediaItem *item = GetSelectedMediaItem(nullptr, i);
+        if (std::find(mPendingDescriptorItems.begin(),
+                      mPendingDescriptorItems.end(),
+                      item) == mPendingDescriptorItems.end())
+            mPendingDescriptorItems.push_back(item);
+    }
+}
+
+void ReacomaExtension::SavePresets() {
+    std::string path = GetPresetsFilePath();
+    if (!path.empty())
+        mPresetWriter->Write(path, mPresetBank->Serialise());
+}
+
+void ReacomaExtension::UpdatePresetChooser() {
+    if (mPresetChooser)
+        mPresetChooser->SetValueStr(mCurrentPresetName.empty()
+                                        ? "Presets"
+                                        : mCurrentPresetName.c_str());
+}
+
+std::string ReacomaExtension::GetCacheDirectoryPath() const {
+    const char *resourcePath = GetResourcePath();
+    if (resourcePath && strlen(resourcePath) > 0) {
+        std::string path(resourcePath);
+        path += "/reacoma-cache";
+        return path;
+    }
+    return "";
+}
+
+MediaItem_Take *ReacomaExtension::GetInputTake(MediaItem *item) const {
+    return mPreviewTakes->GetInputTake(item);
+}
+
+std::string ReacomaExtension::MakeOutputPath(MediaItem_Take *inputTake,
+                                             const std::string &suffix,
+                                             std::string &takeName) {
+    char originalFilePathCStr[4096] = "";
+    if (inputTake) {
+        auto takeSource = GetMediaItemTake_Source(inputTake);
+        if (takeSource) {
+            auto srcParent = GetMediaSourceParent(takeSource);
+            GetMediaSourceFileName(srcParent ? srcParent : takeSource,
+                                   originalFilePathCStr,
+                                   sizeof(originalFilePathCStr));
+        }
+    }
+
+    auto now = std::chrono::system_clock::now();
+    auto in_time_t = std::chrono::system_clock::to_time_t(now);
+    std::stringstream ss;
+    ss << std::put_time(std::localtime(&in_time_t), "%Y%m%d%H%M%S");
+
+    std::filesystem::path originalPath(originalFilePathCStr);
+    auto parentDir = originalPath.parent_path();
+    auto stem = originalPath.stem().string();
+
+    std::filesystem::path reacomaFolder = parentDir / "reacoma";
+    std::filesystem::create_directory(reacomaFolder);
+
+    // Names are made unique by the store, which may add a counter
+    const std::string path =
+        mOutputStore->Reserve(reacomaFolder.u8string(),
+                              stem + "_" + ss.str() + "_" + suffix,
+                              GetOutputExtension(GetOutputFormat()));
+    takeName = std::filesystem::u8path(path).stem().u8string();
+    return path;
+}
+
+uint64_t ReacomaExtension::HashItemState(MediaItem *item) const {
+    Hasher hasher;
+    hasher.AddValue(GetMediaItemInfo_Value(item, "D_LENGTH"));
+
+    // Swapping in a preview take doesn't change what the item is processed
+    // from
+    MediaItem_Take *take = GetInputTake(item);
+    hasher.AddValue(take);
+    if (!take)
+        return hasher.Get();
+
+    hasher.AddValue(GetMediaItemTakeInfo_Value(take, "D_STARTOFFS"));
+    hasher.AddValue(GetMediaItemTakeInfo_Value(take, "D_PLAYRATE"));
+    hasher.AddString(
+        ReadItemOverrides(take, GetAlgorithmKey(mCurrentAlgorithmChoice)));
+
+    PCM_source *source = GetMediaItemTake_Source(take);
+    hasher.AddValue(source);
+    if (source) {
+        char fileName[4096] = "";
+        PCM_source *parent = GetMediaSourceParent(source);
+        GetMediaSourceFileName(parent ? parent : source, fileName,
+                               sizeof(fileName));
+        hasher.AddString(fileName);
+    }
+    return hasher.Get();
+}
+
+uint64_t ReacomaExtension::HashItemInputs(MediaItem *item) const {
+    Hasher hasher;
+    hasher.AddValue(HashItemState(item));
+    hasher.AddValue(mBatchSettingsHash);
+    return hasher.Get();
+}
+
+namespace {
+
+// Index of the take's marker at position, or -1; markers are placed at
+// slice starts, which are rounded to whole samples on the way to the file
+int FindTakeMarker(MediaItem_Take *take, double position) {
+    constexpr double kTolerance = 1e-4;
+    for (int i = 0; i < GetNumTakeMarkers(take); i++) {
+        if (std::abs(GetTakeMarker(take, i, nullptr, 0, nullptr) - position) <
+            kTolerance)
+            return i;
+    }
+    return -1;
+}
+
+// The take with guid in any open project, or nullptr
+MediaItem_Take *FindTakeByGUID(const std::string &guid) {
+    ReaProject *project = nullptr;
+    for (int p = 0; (project = EnumProjects(p, nullptr, 0)); p++) {
+        if (MediaItem_Take *take =
+                GetMediaItemTakeByGUID(project, guid.c_str()))
+            return take;
+    }
+    return nullptr;
+}
+
+} // namespace
+
+void ReacomaExtension::FindSimilarSlices() {
+    constexpr int kNumMatches = 10;
+
+    if (!mCorpusLoaded) {
+        mCorpusIndex->Load(GetCorpusFilePath());
+        mCorpusLoaded = true;
+    }
+
+    // Takes of the selection that have been described, and the slice under
+    // the edit cursor
+    std::vector<CorpusIndex::Take> takes;
+    std::string queryTakeId;
+    double queryPosition = 0.0;
+    const double cursor = GetCursorPosition();
+    for (int i = 0; i < CountSelectedMediaItems(nullptr); ++i) {
+        MediaItem *item = GetSelectedMediaItem(nullptr, i);
+        MediaItem_Take *take = GetInputTake(item);
+        if (!take)
+            continue;
+        char path[4096] = "";
+        if (!GetSetMediaItemTakeInfo_String(take, "P_EXT:reacoma_descriptors",
+                                            path, false) ||
+            !path[0])
+            continue;
+        char guid[64] = "";
+        GetSetMediaItemTakeInfo_String(take, "GUID", guid, false);
+        takes.push_back({guid, path});
+
+        const double itemStart = GetMediaItemInfo_Value(item, "D_POSITION");
+        const double itemLength = GetMediaItemInfo_Value(item, "D_LENGTH");
+        if (queryTakeId.empty() && cursor >= itemStart &&
+            cursor < itemStart + itemLength) {
+            queryTakeId = guid;
+            queryPosition =
+                (cursor - itemStart) *
+                    GetMediaItemTakeInfo_Value(take, "D_PLAYRATE") +
+                GetMediaItemTakeInfo_Value(take, "D_STARTOFFS");
+        }
+    }
+
+    // Slices of takes outside the selection stay in the index, so matches
+    // are found in every described take that still exists
+    auto takeExists = [](const std::string &guid) {
+        return FindTakeByGUID(guid) != nullptr;
+    };
+    if (mCorpusIndex->Update(takes, takeExists)) {
+        const std::string corpusPath = GetCorpusFilePath();
+        if (!corpusPath.empty())
+            mCorpusWriter->Write(corpusPath, mCorpusIndex->Serialise());
+    }
+
+    SliceDescriptors query;
+    if (queryTakeId.empty() ||
+        !mCorpusIndex->FindSlice(queryTakeId, queryPosition, query))
+        return;
+    const std::vector<CorpusIndex::Match> matches =
+        mCorpusIndex->FindNearest(queryTakeId, query, kNumMatches);
+
+    Undo_BeginBlock2(nullptr);
+    PreventUIRefresh(1);
+
+    // Markers left over from the previous search get their colour back
+    for (const HighlightedMarker &marker : mHighlightedMarkers) {
+        if (!ValidatePtr2(nullptr, marker.take, "MediaItem_Take*"))
+            continue;
+        const int index = FindTakeMarker(marker.take, marker.position);
+        if (index < 0)
+            continue;
+        char name[256] = "";
+        GetTakeMarker(marker.take, index, name, sizeof(name), nullptr);
+        int color = marker.color;
+        SetTakeMarker(marker.take, index, name, nullptr, &color);
+    }
+    mHighlightedMarkers.clear();
+
+    // A slice at the start of its take has no marker to colour
+    int highlight = ColorToNative(255, 160, 0) | 0x1000000;
+    for (const CorpusIndex::Match &match : matches) {
+        MediaItem_Take *take = FindTakeByGUID(match.takeId);
+        if (!take)
+            continue;
+        const int index = FindTakeMarker(take, match.slice.start);
+        if (index < 0)
+            continue;
+        char name[256] = "";
+        int color = 0;
+        const double position =
+            GetTakeMarker(take, index, name, sizeof(name), &color);
+        mHighlightedMarkers.push_back({take, position, color});
+        SetTakeMarker(take, index, name, nullptr, &highlight);
+    }
+
+    PreventUIRefresh(-1);
+    Undo_EndBlock2(nullptr, "Reacoma: Find Similar Slices", -1);
+    UpdateArrange();
+    IgnoreOwnProjectChanges();
+}
+
+void ReacomaExtension::SubmitDescriptorRequest(MediaItem *item) {
+    MediaItem_Take *take = GetInputTake(item);
+    if (!take)
+        return;
+    PCM_source *source = GetMediaItemTake_Source(take);
+    if (!source)
+        return;
+
+    const int sampleRate = GetMediaSourceSampleRate(source);
+    const int numChannels = GetMediaSourceNumChannels(source);
+    const double itemLength = GetMediaItemInfo_Value(item, "D_LENGTH");
+    const double playrate = GetMediaItemTakeInfo_Value(take, "D_PLAYRATE");
+    const double takeOffset = GetMediaItemTakeInfo_Value(take, "D_STARTOFFS");
+    const double duration =
+        std::min(itemLength * playrate, source->GetLength() - takeOffset);
+    const int frameCount = static_cast<int>(sampleRate * duration);
+    if (frameCount <= 0 || numChannels <= 0)
+        return;
+
+    char guid[64] = "";
+    GetSetMediaItemTakeInfo_String(take, "GUID", guid, false);
+    std::string takeId(guid);
+    takeId.erase(std::remove_if(takeId.begin(), takeId.end(),
+                                [](char c) { return c == '{' || c == '}'; }),
+                 takeId.end());
+
+    char sourceFileName[4096] = "";
+    PCM_source *parent = GetMediaSourceParent(source);
+    GetMediaSourceFileName(parent ? parent : source, sourceFileName,
+                           sizeof(sourceFileName));
+    std::filesystem::path sourcePath(sourceFileName);
+    std::filesystem::path reacomaFolder = sourcePath.parent_path() / "reacoma";
+    std::error_code error;
+    std::filesystem::create_directory(reacomaFolder, error);
+
+    DescriptorQueue::Request request;
+    request.path = (reacomaFolder / (sourcePath.stem().u8string() + "-" +
+                                     takeId + ".csv"))
+                       .u8string();
+    request.sampleRate = sampleRate;
+    request.sourceOffset = takeOffset;
+
+    std::vector<double> interleaved(static_cast<size_t>(frameCount) *
+                                    numChannels);
+    PCM_source_transfer_t transfer{};
+    transfer.time_s = takeOffset;
+    transfer.samplerate = static_cast<double>(sampleRate);
+    transfer.nch = numChannels;
+    transfer.length = frameCount;
+    transfer.samples = interleaved.data();
+    source->GetSamples(&transfer);
+
+    request.audio.resize(frameCount);
+    const double gain = 1.0 / numChannels;
+    for (int i = 0; i < frameCount; i++) {
+        double sum = 0.0;
+        for (int c = 0; c < numChannels; c++)
+            sum += interleaved[static_cast<size_t>(i) * numChannels + c];
+        request.audio[i] = static_cast<float>(sum * gain);
+    }
+
+    // Take markers are in source time; those outside the item are ignored
+    request.boundaries.push_back(0);
+    for (int i = 0; i < GetNumTakeMarkers(take); i++) {
+        double position =
+            GetTakeMarker(take, i, nullptr, 0, nullptr) - takeOffset;
+        const int frame = static_cast<int>(std::lround(position * sampleRate));
+        if (frame > request.boundaries.back() && frame < frameCount)
+            request.boundaries.push_back(frame);
+    }
+    request.boundaries.push_back(frameCount);
+
+    const std::string path = request.path;
+    request.onComplete = [this, take, path](bool ok) mutable {
+        if (ok && ValidatePtr2(nullptr, take, "MediaItem_Take*")) {
+            GetSetMediaItemTakeInfo_String(take, "P_EXT:reacoma_descriptors",
+                                           &path[0], true);
+            IgnoreOwnProjectChanges();
+        }
+    };
+    mDescriptorQueue->Submit(std::move(request));
+}
+
+namespace {
+
+// Parameters are saved as their values. Files without a version were saved
+// normalised, which moves enum choices whenever an enum grows.
+constexpr const char *kSettingsVersionKey = "Settings_Version";
+constexpr int kSettingsVersion = 2;
+
+// Those files were saved with the algorithms before Novelty Feature
+constexpr int kNumUnversionedAlgorithmChoices = 8;
+
+} // namespace
+
 void ReacomaExtension::SaveState() {
+    mSettingsChanged = false;
+
+    // Saving the defaults before the file was read would overwrite it
     std::string path = GetSettingsFilePath();
-    if (path.empty())
+    if (!mStateLoaded || path.empty())
         return;
 
-    FILE *file = fopen(path.c_str(), "w");
-    if (!file)
+    std::string settings = SerialiseState();
+    if (settings == mSavedSettings)
         return;
+    mSavedSettings = settings;
+    mSettingsWriter->Write(path, std::move(settings));
+}
 
-    // Save the global algorithm choice parameter
-    IParam *pChoiceParam = GetParam(kParamAlgorithmChoice);
-    if (pChoiceParam && pChoiceParam->GetName()) {
-        fprintf(file, "%s=%f\n", pChoiceParam->GetName(),
-                pChoiceParam->GetNormalized());
+std::string ReacomaExtension::SerialiseState() {
+    std::string settings;
+    char line[512];
+
+    snprintf(line, sizeof(line), "%s=%d\n", kSettingsVersionKey,
+             kSettingsVersion);
+    settings += line;
+
+    // Save the global parameters (algorithm choice, output format)
+    for (int i = 0; i < kNumOwnParams; ++i) {
+        IParam *pOwnParam = GetParam(i);
+        if (pOwnParam && pOwnParam->GetName()) {
+            snprintf(line, sizeof(line), "%s=%f\n", pOwnParam->GetName(),
+                     pOwnParam->Value());
+            settings += line;
+        }
     }
 
     // Save all algorithm-specific parameters
@@ -635,11 +1565,12 @@ void ReacomaExtension::SaveState() {
             if (algoNameStr.empty() || paramNameStr.empty())
                 continue;
 
-            fprintf(file, "%s:%s=%f\n", algoNameStr.c_str(),
-                    paramNameStr.c_str(), pParam->GetNormalized());
+            snprintf(line, sizeof(line), "%s:%s=%f\n", algoNameStr.c_str(),
+                     paramNameStr.c_str(), pParam->Value());
+            settings += line;
         }
     }
-    fclose(file);
+    return settings;
 }
 
 void ReacomaExtension::LoadState() {
@@ -667,11 +1598,28 @@ void ReacomaExtension::LoadState() {
         }
     }
 
-    // Load global algorithm choice
-    IParam *pChoiceParam = GetParam(kParamAlgorithmChoice);
-    if (pChoiceParam && pChoiceParam->GetName() &&
-        loadedSettings.count(pChoiceParam->GetName())) {
-        pChoiceParam->SetNormalized(loadedSettings[pChoiceParam->GetName()]);
+    // Older files are read as normalised values once, and then saved again
+    // as values
+    const bool normalised = !loadedSettings.count(kSettingsVersionKey);
+    auto setValue = [normalised](IParam *pParam, double value) {
+        if (normalised)
+            pParam->SetNormalized(value);
+        else
+            pParam->Set(value);
+    };
+
+    // Load global parameters
+    for (int i = 0; i < kNumOwnParams; ++i) {
+        IParam *pOwnParam = GetParam(i);
+        if (pOwnParam && pOwnParam->GetName() &&
+            loadedSettings.count(pOwnParam->GetName())) {
+            double value = loadedSettings[pOwnParam->GetName()];
+            if (normalised && i == kParamAlgorithmChoice)
+                pOwnParam->Set(
+                    std::round(value * (kNumUnversionedAlgorithmChoices - 1)));
+            else
+                setValue(pOwnParam, value);
+        }
     }
 
     // Load algorithm-specific parameters
@@ -694,8 +1642,13 @@ void ReacomaExtension::LoadState() {
 
             std::string key = algoName + ":" + paramName;
             if (loadedSettings.count(key)) {
-                pParam->SetNormalized(loadedSettings[key]);
+                setValue(pParam, loadedSettings[key]);
             }
         }
     }
+
+    // The settings as read, so that SaveState() skips writing them back
+    // until one of them changes
+    if (!normalised)
+        mSavedSettings = SerialiseState();
 }
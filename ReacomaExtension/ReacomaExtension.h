@@ -12,9 +12,11 @@
 #include <deque>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "IAlgorithm.h"
+#include "OutputFormat.h"
 
 namespace iplug {
 namespace igraphics {
@@ -30,12 +32,26 @@ class NMFAlgorithm;
 class TransientAlgorithm;
 class TransientSliceAlgorithm;
 class NoveltySliceAlgorithm;
+class NoveltyFeatureAlgorithm;
+class SinesAlgorithm;
 class OnsetSliceAlgorithm;
 class AmpGateAlgorithm;
 class AmpSliceAlgorithm;
+class AnalysisCache;
+class CorpusIndex;
+class DescriptorQueue;
+class OutputQueue;
+class OutputStore;
+class PeakBuilder;
+class PresetBank;
+class PreviewTakes;
+class ResultMemo;
+class SettingsWriter;
+class StageCache;
 struct ReacomaTheme;
 
 class IAlgorithm;
+class ParameterSnapshot;
 class ProcessingJob;
 
 using namespace iplug;
@@ -44,10 +60,14 @@ using namespace igraphics;
 class ReacomaExtension : public ReaperExtBase {
 
 public:
-    enum class Mode { Segment, Regions, ProcessAudio };
+    enum class Mode { Segment, Regions, Split, Curve, ProcessAudio };
     Mode GetCurrentMode() const { return mCurrentProcessingMode; }
 
-    enum EParams { kParamAlgorithmChoice = 0, kNumOwnParams };
+    enum EParams {
+        kParamAlgorithmChoice = 0,
+        kParamOutputFormat,
+        kNumOwnParams
+    };
 
     enum EControlTags { kCtrlTagAlgoChooser = 0 };
 
@@ -60,16 +80,39 @@ public:
         kHPSS,
         kNMF,
         kTransients,
+        kNoveltyFeature,
+        kSines,
         kNumAlgorithmChoices
     };
 
     ReacomaExtension(reaper_plugin_info_t *pRec);
+    ~ReacomaExtension();
     void OnUIClose() override;
     void Process(Mode mode, bool force);
     void CancelRunningJobs();
     void ResetUIState();
     void SetAlgorithmChoice(EAlgorithmChoice choice, bool triggerUIRelayout);
     void UpdateAutoProcessButtonState();
+    void UpdateCacheStatsLabel();
+    void CommitPreviews();
+    void CollectUnusedOutputs();
+    // Presets of the current algorithm
+    void ApplyPreset(const std::string &name);
+    void SavePresetAs();
+    void DeletePreset(const std::string &name);
+    // Stores the current algorithm's values on the selected items, which
+    // are then processed with them, or clears the stored values
+    void StoreSelectionOverrides();
+    void ClearSelectionOverrides();
+    // Describes the slices between the take markers of the selected items
+    // in the background, writing the descriptors next to each source
+    void DescribeSelection();
+    // Colours the take markers of the slices of the selected items that
+    // sound most like the slice under the edit cursor
+    void FindSimilarSlices();
+    // Identifies an algorithm in presets and per-item overrides
+    std::string GetAlgorithmKey(EAlgorithmChoice choice) const;
+    std::vector<std::string> GetParamNames(const IAlgorithm &algorithm) const;
 
     NoveltySliceAlgorithm *GetNoveltySliceAlgorithm() const {
         return mNoveltyAlgorithm.get();
@@ -91,6 +134,28 @@ public:
     AmpSliceAlgorithm *GetAmpSliceAlgorithm() const {
         return mAmpSliceAlgorithm.get();
     }
+    NoveltyFeatureAlgorithm *GetNoveltyFeatureAlgorithm() const {
+        return mNoveltyFeatureAlgorithm.get();
+    }
+    SinesAlgorithm *GetSinesAlgorithm() const { return mSinesAlgorithm.get(); }
+    AnalysisCache *GetAnalysisCache() const { return mAnalysisCache.get(); }
+    ResultMemo *GetResultMemo() const { return mResultMemo.get(); }
+    StageCache *GetStageCache() const { return mStageCache.get(); }
+    OutputQueue *GetOutputQueue() const { return mOutputQueue.get(); }
+    EOutputFormat GetOutputFormat() {
+        return static_cast<EOutputFormat>(GetParam(kParamOutputFormat)->Int());
+    }
+    PreviewTakes *GetPreviewTakes() const { return mPreviewTakes.get(); }
+    PeakBuilder *GetPeakBuilder() const { return mPeakBuilder.get(); }
+    // Results go to in-memory preview takes rather than files
+    bool IsPreviewing() const { return mAutoProcessMode; }
+    MediaItem_Take *GetInputTake(MediaItem *item) const;
+    // Path for a new file rendered from inputTake, in a reacoma folder next
+    // to its source; takeName receives the name for the take that reads it.
+    // The path is reserved until the output queue completes the file.
+    std::string MakeOutputPath(MediaItem_Take *inputTake,
+                               const std::string &suffix,
+                               std::string &takeName);
 
 private:
     bool mUIRelayoutIsNeeded = false;
@@ -105,15 +170,45 @@ private:
     std::unique_ptr<TransientSliceAlgorithm> mTransientSliceAlgorithm;
     std::unique_ptr<AmpGateAlgorithm> mAmpGateAlgorithm;
     std::unique_ptr<AmpSliceAlgorithm> mAmpSliceAlgorithm;
+    std::unique_ptr<NoveltyFeatureAlgorithm> mNoveltyFeatureAlgorithm;
+    std::unique_ptr<SinesAlgorithm> mSinesAlgorithm;
     std::vector<IAlgorithm *> mAllAlgorithms;
+    std::unique_ptr<AnalysisCache> mAnalysisCache;
+    std::unique_ptr<ResultMemo> mResultMemo;
+    std::unique_ptr<StageCache> mStageCache;
+    std::unique_ptr<OutputStore> mOutputStore;
+    std::unique_ptr<OutputQueue> mOutputQueue;
+    std::unique_ptr<DescriptorQueue> mDescriptorQueue;
+    std::unique_ptr<PeakBuilder> mPeakBuilder;
+    std::unique_ptr<PreviewTakes> mPreviewTakes;
+    std::unique_ptr<SettingsWriter> mSettingsWriter;
+    std::unique_ptr<PresetBank> mPresetBank;
+    std::unique_ptr<SettingsWriter> mPresetWriter;
+    std::unique_ptr<CorpusIndex> mCorpusIndex;
+    std::unique_ptr<SettingsWriter> mCorpusWriter;
 
     void OnParamChangeUI(int paramIdx, EParamSource source) override;
     void OnIdle() override;
     void SetupUI(IGraphics *pGraphics);
     void StartNextItemInQueue();
+    // Takes the project's current state as seen, after the extension has
+    // edited it itself
+    void IgnoreOwnProjectChanges();
+    // Writes the settings in the background if they differ from the last
+    // save; parameter changes call it once they have settled
     void SaveState();
+    std::string SerialiseState();
     void LoadState();
     std::string GetSettingsFilePath() const;
+    std::string GetPresetsFilePath() const;
+    std::string GetCorpusFilePath() const;
+    void SavePresets();
+    void UpdatePresetChooser();
+    std::string GetCacheDirectoryPath() const;
+    uint64_t HashItemState(MediaItem *item) const;
+    uint64_t HashItemInputs(MediaItem *item) const;
+    // Reads the item's take and queues its slices for description
+    void SubmitDescriptorRequest(MediaItem *item);
 
     int mGUIToggle = 0;
 
@@ -126,11 +221,38 @@ private:
     std::list<std::unique_ptr<ProcessingJob>> mActiveJobs;
     std::deque<std::unique_ptr<ProcessingJob>> mFinalizationQueue;
     std::deque<MediaItem *> mProcessingQueue;
+    // Waiting for room in the descriptor queue
+    std::deque<MediaItem *> mPendingDescriptorItems;
+    bool mCorpusLoaded = false;
+    // Markers coloured by the last search, with the colours to restore
+    struct HighlightedMarker {
+        MediaItem_Take *take;
+        double position;
+        int color;
+    };
+    std::vector<HighlightedMarker> mHighlightedMarkers;
+
+    // Input state of each item when it was last processed, so auto-process
+    // only re-runs items whose audio, layout or parameters have changed
+    std::unordered_map<MediaItem *, uint64_t> mProcessedItemInputs;
+    // Finalised in the current batch; their inputs are recorded once the
+    // batch's takes have been added
+    std::vector<MediaItem *> mBatchFinalisedItems;
+    uint64_t mBatchSettingsHash = 0;
+    // Parameters of the current batch, shared by all of its jobs
+    std::shared_ptr<const ParameterSnapshot> mBatchParameters;
+    int mLastProjectStateChangeCount = -1;
 
     iplug::igraphics::ReacomaProgressBar *mProgressBar = nullptr;
     iplug::igraphics::ReacomaButton *mCancelButton = nullptr;
     iplug::igraphics::ReacomaButton *mAutoProcessButton = nullptr;
+    IVButtonControl *mPresetChooser = nullptr;
+    // Names listed by the preset menu when it was last opened
+    std::vector<std::string> mPresetMenuNames;
+    // Preset the current values were loaded from or saved to, if unchanged
+    std::string mCurrentPresetName;
     ITextControl *mProcessingLabel = nullptr;
+    ITextControl *mCacheStatsLabel = nullptr;
     int mProcessingLabelIdx = -1;
     size_t mTotalBatchItems = 0;
     double mLastReportedProgress = 0.0;
@@ -138,6 +260,8 @@ private:
     ReaProject *mBatchUndoProject = nullptr;
     bool mIsProcessingBatch = false;
     bool mIsCancellationRequested = false;
+    ReaProject *mCommitUndoProject = nullptr;
+    bool mIsCommittingPreviews = false;
 
     // handle different processing modes
     bool mAutoProcessMode = false;
@@ -146,6 +270,12 @@ private:
     bool mStateLoaded = false;
     std::chrono::steady_clock::time_point mLastParamChangeTime;
     static constexpr auto AUTO_PROCESS_DELAY = std::chrono::milliseconds(50);
+    bool mSettingsChanged = false;
+    std::chrono::steady_clock::time_point mLastSettingsChangeTime;
+    std::string mSavedSettings;
+    static constexpr auto SETTINGS_SAVE_DELAY = std::chrono::seconds(1);
+    // Time spent building peaks of new takes per idle callback
+    static constexpr auto PEAK_BUILD_BUDGET = std::chrono::milliseconds(10);
 
     // Ellipsis animation
     int mEllipsisCount = 0;
@@ -0,0 +1,41 @@
+#include "ResultMemo.h"
+
+bool ResultMemo::Lookup(uint64_t key, AnalysisResult &result) {
+    auto it = mIndex.find(key);
+    if (it == mIndex.end()) {
+        mMisses++;
+        return false;
+    }
+
+    mEntries.splice(mEntries.begin(), mEntries, it->second);
+    result = it->second->second;
+    mHits++;
+    return true;
+}
+
+void ResultMemo::Store(uint64_t key, const AnalysisResult &result) {
+    if (mCapacity == 0 || result.IsEmpty())
+        return;
+
+    auto it = mIndex.find(key);
+    if (it != mIndex.end()) {
+        it->second->second = result;
+        mEntries.splice(mEntries.begin(), mEntries, it->second);
+        return;
+    }
+
+    mEntries.emplace_front(key, result);
+    mIndex[key] = mEntries.begin();
+
+    while (mEntries.size() > mCapacity) {
+        mIndex.erase(mEntries.back().first);
+        mEntries.pop_back();
+    }
+}
+
+void ResultMemo::Clear() {
+    mEntries.clear();
+    mIndex.clear();
+    mHits = 0;
+    mMisses = 0;
+}
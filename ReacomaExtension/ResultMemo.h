@@ -0,0 +1,43 @@
+#pragma once
+
+#include "AnalysisResult.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+// Small in-memory table of the most recent results, checked before the
+// on-disk AnalysisCache. It makes returning to a previous parameter value
+// (e.g. A/B toggling under auto-process) free. Only used from the main
+// thread.
+class ResultMemo {
+public:
+    static constexpr size_t kDefaultCapacity = 64;
+
+    explicit ResultMemo(size_t capacity = kDefaultCapacity)
+        : mCapacity(capacity) {}
+
+    bool Lookup(uint64_t key, AnalysisResult &result);
+    void Store(uint64_t key, const AnalysisResult &result);
+    void Clear();
+
+    size_t GetHits() const { return mHits; }
+    size_t GetLookups() const { return mHits + mMisses; }
+    double GetHitRate() const {
+        return GetLookups() > 0 ? static_cast<double>(mHits) / GetLookups()
+                                : 0.0;
+    }
+
+private:
+    using Entry = std::pair<uint64_t, AnalysisResult>;
+
+    size_t mCapacity;
+    size_t mHits = 0;
+    size_t mMisses = 0;
+
+    // Most recently used at the front
+    std::list<Entry> mEntries;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> mIndex;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define REACOMA_CONVERT_SSE2 1
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define REACOMA_CONVERT_NEON 1
+#endif
+
+// Widens count floats to doubles, four at a time where SSE2 or NEON is
+// available
+inline void ConvertFloatToDouble(const float *input, double *output,
+                                 size_t count) {
+    size_t i = 0;
+#if defined(REACOMA_CONVERT_SSE2)
+    for (; i + 4 <= count; i += 4) {
+        const __m128 values = _mm_loadu_ps(input + i);
+        _mm_storeu_pd(output + i, _mm_cvtps_pd(values));
+        _mm_storeu_pd(output + i + 2,
+                      _mm_cvtps_pd(_mm_movehl_ps(values, values)));
+    }
+#elif defined(REACOMA_CONVERT_NEON)
+    for (; i + 4 <= count; i += 4) {
+        const float32x4_t values = vld1q_f32(input + i);
+        vst1q_f64(output + i, vcvt_f64_f32(vget_low_f32(values)));
+        vst1q_f64(output + i + 2, vcvt_high_f64_f32(values));
+    }
+#endif
+    for (; i < count; i++)
+        output[i] = input[i];
+}
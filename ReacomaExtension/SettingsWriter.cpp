@@ -0,0 +1,70 @@
+#include "SettingsWriter.h"
+#include "OpenFile.h"
+
+#include <cstdio>
+#include <filesystem>
+
+SettingsWriter::SettingsWriter() : mThread([this] { Run(); }) {}
+
+SettingsWriter::~SettingsWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mWake.notify_all();
+    mThread.join();
+}
+
+void SettingsWriter::Write(const std::string &path, std::string content) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPendingPath = path;
+        mPendingContent = std::move(content);
+        mHasPending = true;
+    }
+    mWake.notify_one();
+}
+
+void SettingsWriter::Run() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mWake.wait(lock, [this] { return mHasPending || mStopping; });
+        if (!mHasPending)
+            return;
+
+        std::string path = std::move(mPendingPath);
+        std::string content = std::move(mPendingContent);
+        mHasPending = false;
+
+        lock.unlock();
+        if ((path != mWrittenPath || content != mWrittenContent) &&
+            WriteFile(path, content)) {
+            mWrittenPath = std::move(path);
+            mWrittenContent = std::move(content);
+        }
+        lock.lock();
+    }
+}
+
+bool SettingsWriter::WriteFile(const std::string &path,
+                               const std::string &content) {
+    const auto destination = std::filesystem::u8path(path);
+    auto tempPath = destination;
+    tempPath += ".tmp";
+
+    FILE *file = OpenFile(tempPath, "wb");
+    if (!file)
+        return false;
+    const bool written =
+        fwrite(content.data(), 1, content.size(), file) == content.size();
+    const bool closed = fclose(file) == 0;
+
+    std::error_code ec;
+    if (written && closed)
+        std::filesystem::rename(tempPath, destination, ec);
+    if (!written || !closed || ec) {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Writes the settings file on a background thread, so that saving never
+// waits on the disk (or the network, for remote home directories). The
+// content is written to a temporary file and renamed over the old one, so
+// a crash mid-write leaves the previous settings intact. Writes that are
+// still pending when a newer one arrives are skipped, as is content equal
+// to what was last written. Anything pending is written on destruction.
+class SettingsWriter {
+public:
+    SettingsWriter();
+    ~SettingsWriter();
+
+    // Main thread
+    void Write(const std::string &path, std::string content);
+
+private:
+    void Run();
+    static bool WriteFile(const std::string &path, const std::string &content);
+
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::string mPendingPath;
+    std::string mPendingContent;
+    bool mHasPending = false;
+    bool mStopping = false;
+
+    // Writer thread only
+    std::string mWrittenPath;
+    std::string mWrittenContent;
+
+    std::thread mThread;
+};
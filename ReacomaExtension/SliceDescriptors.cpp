@@ -0,0 +1,225 @@
+#include "SliceDescriptors.h"
+#include "OpenFile.h"
+
+#include "../dependencies/flucoma-core/include/flucoma/algorithms/public/DCT.hpp"
+#include "../dependencies/flucoma-core/include/flucoma/algorithms/public/Loudness.hpp"
+#include "../dependencies/flucoma-core/include/flucoma/algorithms/public/MelBands.hpp"
+#include "../dependencies/flucoma-core/include/flucoma/algorithms/public/STFT.hpp"
+#include "../dependencies/flucoma-core/include/flucoma/algorithms/public/SpectralShape.hpp"
+#include "../dependencies/flucoma-core/include/flucoma/algorithms/public/YINFFT.hpp"
+#include "../dependencies/flucoma-core/include/flucoma/data/TensorTypes.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+
+namespace {
+
+constexpr int kNumBins = DescriptorAnalyser::kWindowSize / 2 + 1;
+// The defaults of the MFCC and pitch clients
+constexpr double kMinMelFrequency = 20.0;
+constexpr double kMaxMelFrequency = 20000.0;
+constexpr double kMinPitch = 20.0;
+constexpr double kMaxPitch = 10000.0;
+// Frames with a clear pitch, by YIN confidence
+constexpr float kMinPitchConfidence = 0.5f;
+// Frames quieter than this have no centroid
+constexpr float kSilentLoudness = -70.f;
+constexpr float kFloorDb = -120.f;
+
+} // namespace
+
+struct DescriptorAnalyser::Algorithms {
+    explicit Algorithms(int sampleRate)
+        : stft(kWindowSize, kWindowSize, kHopSize),
+          melBands(kNumMelBands, kWindowSize, fluid::FluidDefaultAllocator()),
+          dct(kNumMelBands, SliceDescriptors::kNumMFCCs,
+              fluid::FluidDefaultAllocator()),
+          yin(kNumBins, fluid::FluidDefaultAllocator()),
+          shape(kNumBins, fluid::FluidDefaultAllocator()),
+          loudness(kWindowSize, fluid::FluidDefaultAllocator()),
+          frame(kWindowSize), spectrum(kNumBins), magnitude(kNumBins),
+          bands(kNumMelBands), mfcc(SliceDescriptors::kNumMFCCs), pitch(2),
+          shapeOut(7), loudnessOut(2) {
+        melBands.init(kMinMelFrequency,
+                      std::min(kMaxMelFrequency, sampleRate / 2.0),
+                      kNumMelBands, kNumBins, sampleRate, kWindowSize);
+        dct.init(kNumMelBands, SliceDescriptors::kNumMFCCs);
+        loudness.init(kWindowSize, sampleRate);
+    }
+
+    fluid::algorithm::STFT stft;
+    fluid::algorithm::MelBands melBands;
+    fluid::algorithm::DCT dct;
+    fluid::algorithm::YINFFT yin;
+    fluid::algorithm::SpectralShape shape;
+    fluid::algorithm::Loudness loudness;
+
+    fluid::RealVector frame;
+    fluid::ComplexVector spectrum;
+    fluid::RealVector magnitude;
+    fluid::RealVector bands;
+    fluid::RealVector mfcc;
+    fluid::RealVector pitch;
+    fluid::RealVector shapeOut;
+    fluid::RealVector loudnessOut;
+};
+
+DescriptorAnalyser::DescriptorAnalyser(int sampleRate)
+    : mSampleRate(std::max(sampleRate, 1)),
+      mAlgorithms(std::make_unique<Algorithms>(mSampleRate)) {}
+
+DescriptorAnalyser::~DescriptorAnalyser() = default;
+
+SliceDescriptors DescriptorAnalyser::Analyse(const float *audio,
+                                             int numSamples) {
+    SliceDescriptors descriptors;
+    if (numSamples <= 0)
+        return descriptors;
+
+    const int numFrames = (numSamples - 1) / kHopSize + 1;
+    double powerSum = 0.0;
+    double centroidSum = 0.0;
+    int numSounding = 0;
+    double confidenceSum = 0.0;
+    std::vector<float> pitches;
+    std::array<double, SliceDescriptors::kNumMFCCs> mfccSums{};
+
+    for (int f = 0; f < numFrames; f++) {
+        const Frame frame = AnalyseFrame(audio, numSamples, f * kHopSize);
+        powerSum += std::pow(10.0, frame.loudness / 10.0);
+        if (frame.loudness > kSilentLoudness) {
+            centroidSum += frame.centroid;
+            numSounding++;
+        }
+        confidenceSum += frame.pitchConfidence;
+        if (frame.pitchConfidence >= kMinPitchConfidence)
+            pitches.push_back(frame.pitch);
+        for (int i = 0; i < SliceDescriptors::kNumMFCCs; i++)
+            mfccSums[i] += frame.mfcc[i];
+    }
+
+    const double meanPower = powerSum / numFrames;
+    descriptors.loudness =
+        meanPower > 1e-12 ? float(10.0 * std::log10(meanPower)) : kFloorDb;
+    if (numSounding > 0)
+        descriptors.centroid = float(centroidSum / numSounding);
+    descriptors.pitchConfidence = float(confidenceSum / numFrames);
+    if (!pitches.empty()) {
+        auto middle = pitches.begin() + pitches.size() / 2;
+        std::nth_element(pitches.begin(), middle, pitches.end());
+        descriptors.pitch = *middle;
+    }
+    for (int i = 0; i < SliceDescriptors::kNumMFCCs; i++)
+        descriptors.mfcc[i] = float(mfccSums[i] / numFrames);
+    return descriptors;
+}
+
+DescriptorAnalyser::Frame
+DescriptorAnalyser::AnalyseFrame(const float *audio, int numSamples,
+                                 int start) {
+    Algorithms &a = *mAlgorithms;
+    const int length = std::min(kWindowSize, numSamples - start);
+    for (int n = 0; n < kWindowSize; n++)
+        a.frame(n) = n < length ? audio[start + n] : 0.0;
+
+    Frame result;
+    a.loudness.processFrame(a.frame, a.loudnessOut, true, false,
+                            fluid::FluidDefaultAllocator());
+    result.loudness = float(std::max<double>(a.loudnessOut(0), kFloorDb));
+
+    a.stft.processFrame(a.frame, a.spectrum);
+    fluid::algorithm::STFT::magnitude(a.spectrum, a.magnitude);
+
+    a.melBands.processFrame(a.magnitude, a.bands, false, false, true,
+                            fluid::FluidDefaultAllocator());
+    a.dct.processFrame(a.bands, a.mfcc);
+    for (int i = 0; i < SliceDescriptors::kNumMFCCs; i++)
+        result.mfcc[i] = float(a.mfcc(i));
+
+    a.yin.processFrame(a.magnitude, a.pitch, kMinPitch, kMaxPitch,
+                       mSampleRate, fluid::FluidDefaultAllocator());
+    result.pitch = float(a.pitch(0));
+    result.pitchConfidence = float(a.pitch(1));
+
+    a.shape.processFrame(a.magnitude, a.shapeOut, mSampleRate, 0, -1, 95,
+                         false, false, fluid::FluidDefaultAllocator());
+    result.centroid = float(a.shapeOut(0));
+    return result;
+}
+
+bool WriteDescriptorFile(const std::string &path,
+                         const std::vector<SliceDescriptors> &descriptors) {
+    const auto destination = std::filesystem::u8path(path);
+    auto tempPath = destination;
+    tempPath += ".tmp";
+
+    FILE *file = OpenFile(tempPath, "wb");
+    if (!file)
+        return false;
+
+    bool written =
+        fputs("start,end,loudness,centroid,pitch,pitch_confidence", file) >= 0;
+    for (int i = 0; i < SliceDescriptors::kNumMFCCs; i++)
+        written = fprintf(file, ",mfcc%d", i + 1) > 0 && written;
+    written = fputc('\n', file) != EOF && written;
+
+    for (const auto &slice : descriptors) {
+        written = fprintf(file, "%.9g,%.9g,%.6g,%.6g,%.6g,%.6g", slice.start,
+                          slice.end, slice.loudness, slice.centroid,
+                          slice.pitch, slice.pitchConfidence) > 0 &&
+                  written;
+        for (float coefficient : slice.mfcc)
+            written = fprintf(file, ",%.6g", coefficient) > 0 && written;
+        written = fputc('\n', file) != EOF && written;
+    }
+    const bool closed = fclose(file) == 0;
+
+    std::error_code ec;
+    if (written && closed)
+        std::filesystem::rename(tempPath, destination, ec);
+    if (!written || !closed || ec) {
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+bool ReadDescriptorFile(const std::string &path,
+                        std::vector<SliceDescriptors> &descriptors) {
+    FILE *file = OpenFile(std::filesystem::u8path(path), "rb");
+    if (!file)
+        return false;
+
+    descriptors.clear();
+    constexpr int kNumColumns = 6 + SliceDescriptors::kNumMFCCs;
+    char line[1024];
+    bool ok = fgets(line, sizeof(line), file) != nullptr; // header
+    while (ok && fgets(line, sizeof(line), file)) {
+        double values[kNumColumns];
+        const char *p = line;
+        for (int c = 0; c < kNumColumns && ok; c++) {
+            char *end;
+            values[c] = std::strtod(p, &end);
+            ok = end != p;
+            p = *end == ',' ? end + 1 : end;
+        }
+        if (!ok)
+            break;
+
+        SliceDescriptors slice;
+        slice.start = values[0];
+        slice.end = values[1];
+        slice.loudness = float(values[2]);
+        slice.centroid = float(values[3]);
+        slice.pitch = float(values[4]);
+        slice.pitchConfidence = float(values[5]);
+        for (int i = 0; i < SliceDescriptors::kNumMFCCs; i++)
+            slice.mfcc[i] = float(values[6 + i]);
+        descriptors.push_back(slice);
+    }
+    fclose(file);
+    return ok;
+}
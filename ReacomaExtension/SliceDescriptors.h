@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Summary of the sound of one slice, for sorting and finding similar
+// slices. Slices are identified by their span in the take's source.
+struct SliceDescriptors {
+    static constexpr int kNumMFCCs = 13;
+
+    // Seconds from the start of the take's source, as take markers are
+    double start = 0.0;
+    double end = 0.0;
+    // K-weighted loudness in dB, the power mean of the frames' loudness
+    float loudness = 0.f;
+    // Mean spectral centroid in Hz of the frames that aren't silent
+    float centroid = 0.f;
+    // Median pitch in Hz of the frames with a clear pitch, 0 if none has
+    // one, and the mean confidence over all frames (0..1)
+    float pitch = 0.f;
+    float pitchConfidence = 0.f;
+    // Mean MFCCs over all frames
+    std::array<float, kNumMFCCs> mfcc{};
+};
+
+// Computes SliceDescriptors from mono audio with flucoma's STFT, MelBands
+// and DCT (MFCCs), YINFFT (pitch), SpectralShape (centroid) and Loudness,
+// set up as their clients are by default. Owns the algorithms and their
+// buffers, so each thread analysing slices uses an analyser of its own.
+class DescriptorAnalyser {
+public:
+    static constexpr int kWindowSize = 1024;
+    static constexpr int kHopSize = 512;
+    static constexpr int kNumMelBands = 40;
+
+    explicit DescriptorAnalyser(int sampleRate);
+    ~DescriptorAnalyser();
+
+    // Describes audio[0, numSamples); start and end are copied from the
+    // caller, who knows where the slice lies in the source
+    SliceDescriptors Analyse(const float *audio, int numSamples);
+
+private:
+    struct Frame {
+        float loudness = 0.f;
+        float centroid = 0.f;
+        float pitch = 0.f;
+        float pitchConfidence = 0.f;
+        std::array<float, SliceDescriptors::kNumMFCCs> mfcc{};
+    };
+
+    // The flucoma algorithms and their buffers
+    struct Algorithms;
+
+    Frame AnalyseFrame(const float *audio, int numSamples, int start);
+
+    int mSampleRate;
+    std::unique_ptr<Algorithms> mAlgorithms;
+};
+
+// The descriptors of a take's slices as CSV, one slice per line after a
+// header, so that they can also be read by other tools
+bool WriteDescriptorFile(const std::string &path,
+                         const std::vector<SliceDescriptors> &descriptors);
+bool ReadDescriptorFile(const std::string &path,
+                        std::vector<SliceDescriptors> &descriptors);
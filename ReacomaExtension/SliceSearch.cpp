@@ -0,0 +1,95 @@
+#include "SliceSearch.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+// Steps of the scan down from the top of the curve
+constexpr int kScanSteps = 32;
+
+} // namespace
+
+std::vector<int> DetectSlices(const std::vector<float> &curve, SliceRule rule,
+                              double threshold, int minSliceFrames,
+                              double hysteresis) {
+    std::vector<int> frames;
+    const int numFrames = static_cast<int>(curve.size());
+    int debounce = 0;
+    bool on = false;
+    for (int i = 0; i < numFrames; i++) {
+        const double previous = i > 0 ? curve[i - 1] : 0.0;
+        bool detected;
+        if (rule == SliceRule::kPeak) {
+            detected = i + 1 < numFrames && curve[i] > previous &&
+                       curve[i] > curve[i + 1] && curve[i] > threshold;
+        } else if (rule == SliceRule::kRisingEdge) {
+            detected = curve[i] > threshold && previous < threshold;
+        } else {
+            detected = !on && curve[i] >= threshold && debounce == 0;
+            if (detected)
+                on = true;
+            else if (on && curve[i] <= threshold - hysteresis)
+                on = false;
+        }
+
+        if (detected && debounce == 0) {
+            frames.push_back(i);
+            debounce = minSliceFrames;
+        } else if (debounce > 0) {
+            debounce--;
+        }
+    }
+    return frames;
+}
+
+double FindSliceThreshold(const std::vector<float> &curve, SliceRule rule,
+                          int minSliceFrames, int targetSlices,
+                          double hysteresis) {
+    if (curve.empty())
+        return 0.0;
+
+    const auto range = std::minmax_element(curve.begin(), curve.end());
+    const double bottom = *range.first;
+    const double top = *range.second;
+    double best = top;
+    int bestDistance = targetSlices;
+
+    auto tryThreshold = [&](double threshold) {
+        const int count = static_cast<int>(
+            DetectSlices(curve, rule, threshold, minSliceFrames, hysteresis)
+                .size());
+        const int distance = std::abs(count - targetSlices);
+        if (distance < bestDistance ||
+            (distance == bestDistance && threshold > best)) {
+            best = threshold;
+            bestDistance = distance;
+        }
+        return count;
+    };
+
+    // At the top there are no slices. Scanning down finds the highest step
+    // that reaches the target; the count rises steadily down to there.
+    double high = top;
+    double low = top;
+    bool reached = false;
+    for (int step = 1; step <= kScanSteps && bestDistance > 0; step++) {
+        low = top - (top - bottom) * step / kScanSteps;
+        if (tryThreshold(low) >= targetSlices) {
+            reached = true;
+            break;
+        }
+        high = low;
+    }
+
+    while (reached && bestDistance > 0) {
+        const double threshold = 0.5 * (low + high);
+        if (threshold <= low || threshold >= high)
+            break;
+        if (tryThreshold(threshold) >= targetSlices)
+            low = threshold;
+        else
+            high = threshold;
+    }
+    return best;
+}
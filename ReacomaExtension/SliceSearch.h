@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+
+// Searching for the threshold at which a slicer finds a number of slices,
+// on its detection curve, one value per analysis frame, so that each try
+// doesn't analyse the audio again.
+
+enum class SliceRule {
+    // A slice at every local maximum above the threshold (Novelty Slice)
+    kPeak,
+    // A slice wherever the curve rises above the threshold (Onset Slice)
+    kRisingEdge,
+    // A slice wherever the curve reaches the threshold, after falling to
+    // hysteresis below it since the last one (Amp Slice)
+    kHysteresis
+};
+
+// Frames at which the slicer would start slices, by the rules of flucoma's
+// NoveltySegmentation, OnsetSegmentation and EnvelopeSegmentation: a frame
+// before the curve reads as 0, a slice needs a frame on both sides to be a
+// peak, and after a slice the next minSliceFrames frames can't start
+// another. hysteresis is only read by SliceRule::kHysteresis.
+std::vector<int> DetectSlices(const std::vector<float> &curve, SliceRule rule,
+                              double threshold, int minSliceFrames,
+                              double hysteresis = 0.0);
+
+// Threshold whose number of slices is closest to targetSlices, preferring
+// the higher of equally close thresholds. Near the bottom of the curve a
+// rising edge rarely crosses the threshold, so the count is only monotonic
+// above its maximum: a coarse scan down from the top brackets the target
+// there, and the bracket is then halved until the count matches or the
+// thresholds can't be split any further.
+double FindSliceThreshold(const std::vector<float> &curve, SliceRule rule,
+                          int minSliceFrames, int targetSlices,
+                          double hysteresis = 0.0);
@@ -0,0 +1,43 @@
+#include "StageCache.h"
+
+std::shared_ptr<void> StageCache::GetErased(uint64_t key) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mIndex.find(key);
+    if (it == mIndex.end())
+        return nullptr;
+
+    mEntries.splice(mEntries.begin(), mEntries, it->second);
+    return it->second->stage;
+}
+
+void StageCache::Put(uint64_t key, std::shared_ptr<void> stage,
+                     size_t bytes) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mIndex.find(key);
+    if (it != mIndex.end())
+        RemoveLocked(it->second);
+
+    // A stage larger than the whole budget would only evict everything else
+    if (!stage || bytes > mMaxBytes)
+        return;
+
+    mEntries.push_front({key, std::move(stage), bytes});
+    mIndex[key] = mEntries.begin();
+    mTotalBytes += bytes;
+
+    while (mTotalBytes > mMaxBytes && !mEntries.empty())
+        RemoveLocked(std::prev(mEntries.end()));
+}
+
+void StageCache::Clear() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEntries.clear();
+    mIndex.clear();
+    mTotalBytes = 0;
+}
+
+void StageCache::RemoveLocked(std::list<Entry>::iterator position) {
+    mTotalBytes -= position->bytes;
+    mIndex.erase(position->key);
+    mEntries.erase(position);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+// In-memory store for intermediate analysis stages (NMF factors,
+// spectrograms, model fits) that let a later run on the same item skip its
+// most expensive work. Entries are type-erased; every caller must fold a
+// stage-specific tag into its key so a key always maps to one type.
+// Bounded by an approximate byte budget with LRU eviction. Thread-safe, as
+// stages are read and written from worker threads.
+class StageCache {
+public:
+    static constexpr size_t kDefaultMaxBytes = 512ull * 1024 * 1024;
+
+    explicit StageCache(size_t maxBytes = kDefaultMaxBytes)
+        : mMaxBytes(maxBytes) {}
+
+    template <typename T> std::shared_ptr<T> Get(uint64_t key) {
+        return std::static_pointer_cast<T>(GetErased(key));
+    }
+
+    void Put(uint64_t key, std::shared_ptr<void> stage, size_t bytes);
+    void Clear();
+
+private:
+    struct Entry {
+        uint64_t key;
+        std::shared_ptr<void> stage;
+        size_t bytes;
+    };
+
+    std::shared_ptr<void> GetErased(uint64_t key);
+    void RemoveLocked(std::list<Entry>::iterator position);
+
+    std::mutex mMutex;
+    size_t mMaxBytes;
+    size_t mTotalBytes = 0;
+
+    // Most recently used at the front
+    std::list<Entry> mEntries;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> mIndex;
+};
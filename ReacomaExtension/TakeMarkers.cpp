@@ -0,0 +1,153 @@
+#include "TakeMarkers.h"
+
+#include "wdltypes.h"
+#include "reaper_plugin_functions.h"
+
+#include <algorithm>
+#include <cmath>
+
+std::vector<TakeMarkerEdit> DiffTakeMarkers(
+    const std::vector<TakeMarker> &existing,
+    const std::vector<TakeMarker> &desired, double tolerance) {
+    const int numExisting = static_cast<int>(existing.size());
+    const int numDesired = static_cast<int>(desired.size());
+
+    // The desired marker each existing one becomes, or -1 to delete it
+    std::vector<int> target(numExisting, -1);
+    std::vector<bool> kept(numExisting, false);
+    std::vector<int> inserts;
+
+    // Unmatched markers between two kept ones are paired up as moves,
+    // which keeps every marker in the same order relative to the others
+    std::vector<int> gapDeletes;
+    std::vector<int> gapInserts;
+    auto closeGap = [&]() {
+        const size_t numMoves = std::min(gapDeletes.size(), gapInserts.size());
+        for (size_t k = 0; k < numMoves; k++)
+            target[gapDeletes[k]] = gapInserts[k];
+        inserts.insert(inserts.end(), gapInserts.begin() + numMoves,
+                       gapInserts.end());
+        gapDeletes.clear();
+        gapInserts.clear();
+    };
+
+    int i = 0;
+    int j = 0;
+    while (i < numExisting || j < numDesired) {
+        if (i < numExisting && j < numDesired &&
+            std::fabs(existing[i].position - desired[j].position) <=
+                tolerance) {
+            closeGap();
+            target[i] = j;
+            kept[i] = true;
+            i++;
+            j++;
+        } else if (j == numDesired ||
+                   (i < numExisting &&
+                    existing[i].position < desired[j].position)) {
+            gapDeletes.push_back(i++);
+        } else {
+            gapInserts.push_back(j++);
+        }
+    }
+    closeGap();
+
+    std::vector<TakeMarkerEdit> edits;
+
+    // Deleting from the end leaves the indices still to delete unchanged
+    for (int e = numExisting - 1; e >= 0; e--) {
+        if (target[e] < 0)
+            edits.push_back({TakeMarkerEdit::kDelete, e, existing[e]});
+    }
+
+    std::vector<int> index(numExisting, -1);
+    for (int e = 0, next = 0; e < numExisting; e++) {
+        if (target[e] >= 0)
+            index[e] = next++;
+    }
+
+    // Since order is preserved, a marker moving right never passes one above
+    // it once those have moved, nor one below it; likewise for left moves
+    for (int e = numExisting - 1; e >= 0; e--) {
+        if (target[e] >= 0 && !kept[e] &&
+            desired[target[e]].position > existing[e].position)
+            edits.push_back(
+                {TakeMarkerEdit::kSet, index[e], desired[target[e]]});
+    }
+    for (int e = 0; e < numExisting; e++) {
+        if (target[e] >= 0 && !kept[e] &&
+            desired[target[e]].position <= existing[e].position)
+            edits.push_back(
+                {TakeMarkerEdit::kSet, index[e], desired[target[e]]});
+    }
+
+    for (int e = 0; e < numExisting; e++) {
+        if (kept[e] && existing[e].color != desired[target[e]].color)
+            edits.push_back({TakeMarkerEdit::kSet, index[e],
+                             {existing[e].position, desired[target[e]].color}});
+    }
+
+    for (int d : inserts)
+        edits.push_back({TakeMarkerEdit::kInsert, -1, desired[d]});
+    return edits;
+}
+
+void ApplyTakeMarkers(MediaItem_Take *take, std::vector<TakeMarker> desired,
+                      double tolerance) {
+    std::stable_sort(desired.begin(), desired.end(),
+                     [](const TakeMarker &a, const TakeMarker &b) {
+                         return a.position < b.position;
+                     });
+    desired.erase(std::unique(desired.begin(), desired.end(),
+                              [tolerance](const TakeMarker &a,
+                                          const TakeMarker &b) {
+                                  return b.position - a.position <= tolerance;
+                              }),
+                  desired.end());
+
+    const int numExisting = GetNumTakeMarkers(take);
+    std::vector<TakeMarker> existing(numExisting);
+    bool sorted = true;
+    for (int i = 0; i < numExisting; i++) {
+        existing[i].position =
+            GetTakeMarker(take, i, nullptr, 0, &existing[i].color);
+        if (i > 0 && existing[i].position < existing[i - 1].position)
+            sorted = false;
+    }
+
+    // REAPER keeps take markers sorted; replace them all if they aren't
+    std::vector<TakeMarkerEdit> edits;
+    if (sorted) {
+        edits = DiffTakeMarkers(existing, desired, tolerance);
+    } else {
+        for (int i = numExisting - 1; i >= 0; i--)
+            edits.push_back({TakeMarkerEdit::kDelete, i, existing[i]});
+        for (const auto &marker : desired)
+            edits.push_back({TakeMarkerEdit::kInsert, -1, marker});
+    }
+    if (edits.empty())
+        return;
+
+    PreventUIRefresh(1);
+    for (const auto &edit : edits) {
+        double position = edit.marker.position;
+        int color = edit.marker.color;
+        switch (edit.type) {
+            case TakeMarkerEdit::kDelete:
+                DeleteTakeMarker(take, edit.index);
+                break;
+            case TakeMarkerEdit::kSet: {
+                // Moving a marker keeps whatever name it was given
+                char name[256] = "";
+                GetTakeMarker(take, edit.index, name, sizeof(name), nullptr);
+                SetTakeMarker(take, edit.index, name, &position, &color);
+                break;
+            }
+            case TakeMarkerEdit::kInsert:
+                SetTakeMarker(take, -1, "", &position,
+                              color != 0 ? &color : nullptr);
+                break;
+        }
+    }
+    PreventUIRefresh(-1);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "reaper_plugin.h"
+
+#include <vector>
+
+struct TakeMarker {
+    // Seconds from the start of the take's source
+    double position = 0.0;
+    // Native colour with the 0x1000000 flag, or 0 for the default colour
+    int color = 0;
+};
+
+// One REAPER call. Indices are those of the take's markers at the point the
+// edit is applied; inserted markers take their index from their position.
+struct TakeMarkerEdit {
+    enum EType { kDelete, kSet, kInsert };
+
+    EType type;
+    int index;
+    TakeMarker marker;
+};
+
+// Edits that turn existing into desired, both sorted by position. Markers
+// within tolerance of a desired marker are kept where they are; markers
+// that have to go are moved to nearby new positions rather than deleted and
+// re-added. The edits are ordered so that each index stays valid while
+// REAPER re-sorts the markers after every call.
+std::vector<TakeMarkerEdit> DiffTakeMarkers(
+    const std::vector<TakeMarker> &existing,
+    const std::vector<TakeMarker> &desired, double tolerance);
+
+// Replaces the take's markers with desired using the fewest calls, with UI
+// refreshes suspended until all of them are applied. desired need not be
+// sorted; of several markers within tolerance, the first one listed is kept.
+void ApplyTakeMarkers(MediaItem_Take *take, std::vector<TakeMarker> desired,
+                      double tolerance);
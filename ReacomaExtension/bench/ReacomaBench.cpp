@@ -0,0 +1,346 @@
+// Headless benchmarks of Reacoma's processing, run on WAV files;
+// scripts/bench.sh converts the TestProject media and runs them all.
+//
+//   reacoma-bench hpss FILE...   checks the cached HPSS separation against
+//                                NRTThreadedHPSSClient at several filter
+//                                sizes, then times a sweep of harmonic
+//                                filter sizes from 17 to 101 both ways
+//   reacoma-bench sines FILE...  realtime factor of the sines separation,
+//                                one client per channel as in Reacoma
+//
+// The HPSS check exits with status 1 if the two differ by more than
+// kTolerance on any sample.
+
+#include "../../dependencies/flucoma-core/include/flucoma/clients/common/MemoryBufferAdaptor.hpp"
+#include "../../dependencies/flucoma-core/include/flucoma/clients/rt/HPSSClient.hpp"
+#include "../../dependencies/flucoma-core/include/flucoma/clients/rt/SinesClient.hpp"
+#include "HPSSSeparation.h"
+#include "VectorBufferAdaptor.h"
+#include "WavFile.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace fluid;
+using namespace fluid::client;
+
+namespace {
+
+// Outputs are float, computed in double by both
+constexpr double kTolerance = 1e-4;
+
+// Reacoma's defaults
+constexpr int kWindowSize = 1024;
+constexpr int kHopSize = 512;
+constexpr int kFFTSize = 1024;
+constexpr int kPercFilterSize = 31;
+
+// Harmonic and percussive filter sizes checked against the client
+constexpr std::pair<int, int> kCheckedFilterSizes[] = {
+    {17, 31}, {31, 17}, {51, 51}, {75, 3}, {101, 101}};
+
+constexpr int kSweepFrom = 17;
+constexpr int kSweepTo = 101;
+constexpr int kSweepStep = 12;
+
+using Clock = std::chrono::steady_clock;
+
+double SecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Both parts of every channel, one channel after the other
+struct HPSSOutput {
+    std::vector<float> harmonic;
+    std::vector<float> percussive;
+};
+
+bool ReadChannels(MemoryBufferAdaptor *buffer, int numChannels, int numFrames,
+                  std::vector<float> &out) {
+    BufferAdaptor::ReadAccess reader(buffer);
+    if (!reader.exists() || !reader.valid() ||
+        reader.numChans() < numChannels || reader.numFrames() < numFrames)
+        return false;
+    out.resize(static_cast<size_t>(numChannels) * numFrames);
+    for (int c = 0; c < numChannels; c++) {
+        auto samples = reader.samps(c);
+        for (int i = 0; i < numFrames; i++)
+            out[static_cast<size_t>(c) * numFrames + i] = samples(i);
+    }
+    return true;
+}
+
+// The separation as Reacoma ran it before the spectrogram was cached
+bool RunHPSSClient(const WavFile &wav, int harmFilterSize, int percFilterSize,
+                   HPSSOutput &output) {
+    const int numChannels = static_cast<int>(wav.channels.size());
+    const int numFrames = wav.GetNumFrames();
+    std::vector<float> interleaved(static_cast<size_t>(numChannels) *
+                                   numFrames);
+    for (int i = 0; i < numFrames; i++)
+        for (int c = 0; c < numChannels; c++)
+            interleaved[static_cast<size_t>(i) * numChannels + c] =
+                wav.channels[c][i];
+
+    auto harmonic = std::make_shared<MemoryBufferAdaptor>(
+        numChannels, numFrames, wav.sampleRate);
+    auto percussive = std::make_shared<MemoryBufferAdaptor>(
+        numChannels, numFrames, wav.sampleRate);
+
+    FluidContext context;
+    NRTThreadedHPSSClient::ParamSetType params{
+        NRTThreadedHPSSClient::getParameterDescriptors(),
+        FluidDefaultAllocator()};
+    params.template set<0>(InputBufferT::type(new VectorBufferAdaptor(
+                               interleaved, numChannels, numFrames,
+                               wav.sampleRate)),
+                           nullptr);
+    params.template set<1>(LongT::type(0), nullptr);
+    params.template set<2>(LongT::type(-1), nullptr);
+    params.template set<3>(LongT::type(0), nullptr);
+    params.template set<4>(LongT::type(-1), nullptr);
+    params.template set<5>(BufferT::type(harmonic), nullptr);
+    params.template set<6>(BufferT::type(percussive), nullptr);
+    params.template set<7>(nullptr, nullptr);
+    params.template set<8>(LongRuntimeMaxParam(harmFilterSize, harmFilterSize),
+                           nullptr);
+    params.template set<9>(LongRuntimeMaxParam(percFilterSize, percFilterSize),
+                           nullptr);
+    params.template set<10>(LongT::type(0), nullptr);
+    params.template set<11>(FloatPairsArrayT::type(0, 1, 1, 1), nullptr);
+    params.template set<12>(FloatPairsArrayT::type(1, 0, 1, 1), nullptr);
+    params.template set<13>(FFTParams(kWindowSize, kHopSize, kFFTSize,
+                                      std::max(kWindowSize, kFFTSize)),
+                            nullptr);
+
+    NRTThreadedHPSSClient client(params, context);
+    client.setSynchronous(true);
+    client.enqueue(params);
+    if (!client.process().ok())
+        return false;
+    return ReadChannels(harmonic.get(), numChannels, numFrames,
+                        output.harmonic) &&
+           ReadChannels(percussive.get(), numChannels, numFrames,
+                        output.percussive);
+}
+
+std::shared_ptr<HPSSSpectrogram> AnalyseWav(const WavFile &wav) {
+    const int numFrames = wav.GetNumFrames();
+    std::vector<float> audio;
+    audio.reserve(wav.channels.size() * numFrames);
+    for (const auto &channel : wav.channels)
+        audio.insert(audio.end(), channel.begin(), channel.end());
+    return AnalyseHPSS(audio, static_cast<int>(wav.channels.size()),
+                       numFrames, kWindowSize, kHopSize, kFFTSize,
+                       [](double) { return true; });
+}
+
+// The separation as HPSSAlgorithm runs it on a cached spectrogram
+bool SeparateWav(HPSSSpectrogram &spectrogram, const WavFile &wav,
+                 int harmFilterSize, int percFilterSize, HPSSOutput &output) {
+    const int numChannels = static_cast<int>(wav.channels.size());
+    const int numFrames = wav.GetNumFrames();
+    auto harmonic = std::make_shared<MemoryBufferAdaptor>(
+        numChannels, numFrames, wav.sampleRate);
+    auto percussive = std::make_shared<MemoryBufferAdaptor>(
+        numChannels, numFrames, wav.sampleRate);
+    {
+        BufferAdaptor::Access harmonicOut(harmonic.get());
+        BufferAdaptor::Access percussiveOut(percussive.get());
+        if (!harmonicOut.exists() || !percussiveOut.exists())
+            return false;
+        for (int c = 0; c < numChannels; c++) {
+            if (!SeparateHPSS(spectrogram.channels[c], numFrames, kWindowSize,
+                              kHopSize, kFFTSize, harmFilterSize,
+                              percFilterSize, harmonicOut.samps(c),
+                              percussiveOut.samps(c),
+                              [](double) { return true; }))
+                return false;
+        }
+    }
+    return ReadChannels(harmonic.get(), numChannels, numFrames,
+                        output.harmonic) &&
+           ReadChannels(percussive.get(), numChannels, numFrames,
+                        output.percussive);
+}
+
+double MaxDifference(const std::vector<float> &a, const std::vector<float> &b) {
+    if (a.size() != b.size())
+        return INFINITY;
+    double difference = 0.0;
+    for (size_t i = 0; i < a.size(); i++)
+        difference = std::max(difference, std::abs(double(a[i]) - b[i]));
+    return difference;
+}
+
+bool BenchHPSS(const std::string &path, const WavFile &wav) {
+    const double duration = double(wav.GetNumFrames()) / wav.sampleRate;
+    printf("%s: %d channels, %.1f s\n", path.c_str(),
+           static_cast<int>(wav.channels.size()), duration);
+
+    auto spectrogram = AnalyseWav(wav);
+    if (!spectrogram) {
+        printf("  analysis failed\n");
+        return false;
+    }
+
+    bool matches = true;
+    for (const auto &[harmFilterSize, percFilterSize] : kCheckedFilterSizes) {
+        HPSSOutput expected;
+        HPSSOutput actual;
+        if (!RunHPSSClient(wav, harmFilterSize, percFilterSize, expected) ||
+            !SeparateWav(*spectrogram, wav, harmFilterSize, percFilterSize,
+                         actual)) {
+            printf("  harmonic %3d percussive %3d: failed\n", harmFilterSize,
+                   percFilterSize);
+            matches = false;
+            continue;
+        }
+        const double difference =
+            std::max(MaxDifference(expected.harmonic, actual.harmonic),
+                     MaxDifference(expected.percussive, actual.percussive));
+        const bool ok = difference <= kTolerance;
+        printf("  harmonic %3d percussive %3d: max difference %.3g %s\n",
+               harmFilterSize, percFilterSize, difference,
+               ok ? "ok" : "MISMATCH");
+        matches = matches && ok;
+    }
+
+    // A sweep as made by dragging the harmonic filter size: the client
+    // reruns everything each time, the cached path analyses once
+    int numSizes = 0;
+    auto start = Clock::now();
+    for (int size = kSweepFrom; size <= kSweepTo; size += kSweepStep) {
+        HPSSOutput output;
+        RunHPSSClient(wav, size, kPercFilterSize, output);
+        numSizes++;
+    }
+    const double clientSeconds = SecondsSince(start);
+
+    start = Clock::now();
+    auto sweepSpectrogram = AnalyseWav(wav);
+    const double analysisSeconds = SecondsSince(start);
+    for (int size = kSweepFrom; size <= kSweepTo; size += kSweepStep) {
+        HPSSOutput output;
+        SeparateWav(*sweepSpectrogram, wav, size, kPercFilterSize, output);
+    }
+    const double cachedSeconds = SecondsSince(start);
+
+    printf("  sweep of %d harmonic filter sizes, %d to %d:\n", numSizes,
+           kSweepFrom, kSweepTo);
+    printf("    client   %8.3f s, %.3f s per size\n", clientSeconds,
+           clientSeconds / numSizes);
+    printf("    cached   %8.3f s, %.3f s analysis, %.3f s per size\n",
+           cachedSeconds, analysisSeconds,
+           (cachedSeconds - analysisSeconds) / numSizes);
+    printf("    speedup  %8.2fx\n", clientSeconds / cachedSeconds);
+    return matches;
+}
+
+// Sines separation of one channel, with SinesAlgorithm's defaults
+bool RunSinesClient(std::vector<float> channel, int sampleRate,
+                    int trackingMethod) {
+    const int numFrames = static_cast<int>(channel.size());
+    auto sines =
+        std::make_shared<MemoryBufferAdaptor>(1, numFrames, sampleRate);
+    auto residual =
+        std::make_shared<MemoryBufferAdaptor>(1, numFrames, sampleRate);
+
+    FluidContext context;
+    NRTThreadedSinesClient::ParamSetType params{
+        NRTThreadedSinesClient::getParameterDescriptors(),
+        FluidDefaultAllocator()};
+    params.template set<0>(InputBufferT::type(new VectorBufferAdaptor(
+                               channel, 1, numFrames, sampleRate)),
+                           nullptr);
+    params.template set<1>(LongT::type(0), nullptr);
+    params.template set<2>(LongT::type(-1), nullptr);
+    params.template set<3>(LongT::type(0), nullptr);
+    params.template set<4>(LongT::type(-1), nullptr);
+    params.template set<5>(BufferT::type(sines), nullptr);
+    params.template set<6>(BufferT::type(residual), nullptr);
+    params.template set<7>(LongT::type(76), nullptr);
+    params.template set<8>(FloatT::type(-96.0), nullptr);
+    params.template set<9>(FloatT::type(-24.0), nullptr);
+    params.template set<10>(FloatT::type(-60.0), nullptr);
+    params.template set<11>(LongT::type(15), nullptr);
+    params.template set<12>(LongT::type(trackingMethod), nullptr);
+    params.template set<13>(FloatT::type(15.0), nullptr);
+    params.template set<14>(FloatT::type(50.0), nullptr);
+    params.template set<15>(FloatT::type(0.5), nullptr);
+    params.template set<16>(FFTParams(kWindowSize, kHopSize, kFFTSize,
+                                      std::max(kWindowSize, kFFTSize)),
+                            nullptr);
+
+    NRTThreadedSinesClient client(params, context);
+    client.setSynchronous(true);
+    client.enqueue(params);
+    return client.process().ok();
+}
+
+bool BenchSines(const std::string &path, const WavFile &wav) {
+    const int numChannels = static_cast<int>(wav.channels.size());
+    const double duration = double(wav.GetNumFrames()) / wav.sampleRate;
+    printf("%s: %d channels, %.1f s\n", path.c_str(), numChannels, duration);
+
+    bool ok = true;
+    const char *methods[] = {"greedy", "hungarian"};
+    for (int method = 0; method < 2; method++) {
+        std::vector<char> succeeded(numChannels, 0);
+        const auto start = Clock::now();
+        std::vector<std::thread> threads;
+        for (int c = 0; c < numChannels; c++)
+            threads.emplace_back([&, c] {
+                succeeded[c] =
+                    RunSinesClient(wav.channels[c], wav.sampleRate, method);
+            });
+        for (auto &thread : threads)
+            thread.join();
+        const double seconds = SecondsSince(start);
+
+        const bool allSucceeded =
+            std::find(succeeded.begin(), succeeded.end(), 0) ==
+            succeeded.end();
+        printf("  %-9s %8.3f s, %6.1fx realtime%s\n", methods[method],
+               seconds, duration / seconds, allSucceeded ? "" : ", FAILED");
+        ok = ok && allSucceeded;
+    }
+    return ok;
+}
+
+int Usage() {
+    fprintf(stderr, "usage: reacoma-bench hpss|sines FILE.wav...\n");
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    if (argc < 3)
+        return Usage();
+    const bool hpss = std::strcmp(argv[1], "hpss") == 0;
+    const bool sines = std::strcmp(argv[1], "sines") == 0;
+    if (!hpss && !sines)
+        return Usage();
+
+    bool ok = true;
+    for (int i = 2; i < argc; i++) {
+        WavFile wav;
+        std::string error;
+        if (!ReadWavFile(argv[i], wav, error) || wav.GetNumFrames() == 0) {
+            fprintf(stderr, "%s\n", error.c_str());
+            ok = false;
+            continue;
+        }
+        ok = (hpss ? BenchHPSS(argv[i], wav) : BenchSines(argv[i], wav)) && ok;
+    }
+    return ok ? 0 : 1;
+}
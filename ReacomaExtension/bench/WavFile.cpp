@@ -0,0 +1,102 @@
+#include "WavFile.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+constexpr uint16_t kFormatPCM = 1;
+constexpr uint16_t kFormatFloat = 3;
+constexpr uint16_t kFormatExtensible = 0xFFFE;
+
+uint32_t ReadLE(const unsigned char *bytes, int numBytes) {
+    uint32_t value = 0;
+    for (int i = numBytes - 1; i >= 0; i--)
+        value = (value << 8) | bytes[i];
+    return value;
+}
+
+float DecodeSample(const unsigned char *bytes, uint16_t format,
+                   int bitsPerSample) {
+    if (format == kFormatFloat) {
+        float value;
+        std::memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+    const int numBytes = bitsPerSample / 8;
+    // Sign-extended from the top byte of the sample
+    const uint32_t raw = ReadLE(bytes, numBytes) << (32 - bitsPerSample);
+    return static_cast<float>(static_cast<int32_t>(raw) / 2147483648.0);
+}
+
+} // namespace
+
+bool ReadWavFile(const std::string &path, WavFile &wav, std::string &error) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file) {
+        error = "can't open " + path;
+        return false;
+    }
+
+    std::vector<unsigned char> data;
+    unsigned char buffer[65536];
+    size_t numRead;
+    while ((numRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.insert(data.end(), buffer, buffer + numRead);
+    fclose(file);
+
+    if (data.size() < 12 || std::memcmp(data.data(), "RIFF", 4) != 0 ||
+        std::memcmp(data.data() + 8, "WAVE", 4) != 0) {
+        error = path + " is not a WAV file";
+        return false;
+    }
+
+    uint16_t format = 0;
+    int numChannels = 0;
+    int bitsPerSample = 0;
+    const unsigned char *samples = nullptr;
+    size_t numBytes = 0;
+    for (size_t pos = 12; pos + 8 <= data.size();) {
+        const unsigned char *chunk = data.data() + pos;
+        const size_t size = ReadLE(chunk + 4, 4);
+        const size_t available = std::min(size, data.size() - pos - 8);
+        if (std::memcmp(chunk, "fmt ", 4) == 0 && available >= 16) {
+            format = static_cast<uint16_t>(ReadLE(chunk + 8, 2));
+            numChannels = static_cast<int>(ReadLE(chunk + 10, 2));
+            wav.sampleRate = static_cast<int>(ReadLE(chunk + 12, 4));
+            bitsPerSample = static_cast<int>(ReadLE(chunk + 22, 2));
+            // The format proper is the start of the sub-format GUID
+            if (format == kFormatExtensible && available >= 26)
+                format = static_cast<uint16_t>(ReadLE(chunk + 32, 2));
+        } else if (std::memcmp(chunk, "data", 4) == 0) {
+            samples = chunk + 8;
+            numBytes = available;
+        }
+        // Chunks are padded to an even size
+        pos += 8 + size + (size & 1);
+    }
+
+    const bool supported =
+        (format == kFormatPCM &&
+         (bitsPerSample == 16 || bitsPerSample == 24 || bitsPerSample == 32)) ||
+        (format == kFormatFloat && bitsPerSample == 32);
+    if (!samples || numChannels <= 0 || wav.sampleRate <= 0 || !supported) {
+        error = path + " has no audio in a supported format";
+        return false;
+    }
+
+    const size_t frameBytes = static_cast<size_t>(numChannels) *
+                              (bitsPerSample / 8);
+    const size_t numFrames = numBytes / frameBytes;
+    wav.channels.assign(numChannels, std::vector<float>(numFrames));
+    for (size_t i = 0; i < numFrames; i++) {
+        for (int c = 0; c < numChannels; c++) {
+            const unsigned char *sample =
+                samples + i * frameBytes + c * (bitsPerSample / 8);
+            wav.channels[c][i] = DecodeSample(sample, format, bitsPerSample);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Audio of a WAV file, one vector of samples per channel
+struct WavFile {
+    int sampleRate = 0;
+    std::vector<std::vector<float>> channels;
+
+    int GetNumFrames() const {
+        return channels.empty() ? 0 : static_cast<int>(channels[0].size());
+    }
+};
+
+// Reads 16, 24 or 32-bit integer or 32-bit float PCM, as wvunpack writes it
+bool ReadWavFile(const std::string &path, WavFile &wav, std::string &error);
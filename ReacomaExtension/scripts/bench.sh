@@ -0,0 +1,46 @@
+#!/usr/bin/env bash
+# Builds reacoma-bench and runs one of its benchmarks, by default on the
+# TestProject media:
+#
+#   scripts/bench.sh hpss|sines [FILE.wv|FILE.wav...]
+#
+# WavPack files are converted to WAV first with wvunpack, from WavPack.
+set -euo pipefail
+
+root="$(cd "$(dirname "$0")/.." && pwd)"
+build="$root/build/bench"
+
+if [ $# -lt 1 ]; then
+    echo "usage: $0 hpss|sines [FILE.wv|FILE.wav...]" >&2
+    exit 2
+fi
+benchmark="$1"
+shift
+if [ $# -eq 0 ]; then
+    set -- "$root"/TestProject/media/*.wv
+fi
+
+cmake -S "$root" -B "$build" -DCMAKE_BUILD_TYPE=Release \
+    -DREACOMA_BUILD_BENCH=ON >/dev/null
+cmake --build "$build" --target reacoma-bench --config Release
+
+temp="$(mktemp -d)"
+trap 'rm -rf "$temp"' EXIT
+
+files=()
+for file in "$@"; do
+    case "$file" in
+    *.wv)
+        wav="$temp/$(basename "${file%.wv}").wav"
+        wvunpack -q -y "$file" "$wav"
+        files+=("$wav")
+        ;;
+    *)
+        files+=("$file")
+        ;;
+    esac
+done
+
+bench="$build/reacoma-bench"
+[ -x "$bench" ] || bench="$build/Release/reacoma-bench"
+"$bench" "$benchmark" "${files[@]}"